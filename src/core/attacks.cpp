@@ -38,21 +38,24 @@ uint64_t rook_magic_numbers[64];
 Bitboard pawn_attacks[2][64];
 Bitboard knight_attacks[64];
 Bitboard king_attacks[64];
-Bitboard bishop_attacks[64][512];
-Bitboard rook_attacks[64][4096];
+Bitboard slider_attacks[BISHOP_TABLE_SIZE + ROOK_TABLE_SIZE];
+Bitboard *bishop_attacks[64];
+Bitboard *rook_attacks[64];
 
 //=== Adapted from Stockfish.
 // Initialize all attacks, masks, magics and shifts tables for piece_type.
-// piece_type must by Bishop or Rook
+// piece_type must by Bishop or Rook. With PEXT no magics are needed, only the masks and attacks
 void init_magic_table(PieceType piece_type) {
     assert(piece_type == BISHOP || piece_type == ROOK);
 
+#if !defined(USE_PEXT)
     // Maybe optimal PRNG seeds to pick the correct magics in the shortest time
     int seeds[8] = {728, 10316, 55013, 32803, 12281, 15100, 16645, 255};
+    int epoch[4096] = {}, cnt = 0;
+#endif
 
     Bitboard occupancy[4096];
     Bitboard reference[4096];
-    int epoch[4096] = {}, cnt = 0;
 
     for (int sqi = a1; sqi <= h8; ++sqi) {
         Square sq = static_cast<Square>(sqi);
@@ -63,12 +66,15 @@ void init_magic_table(PieceType piece_type) {
         if (piece_type == BISHOP) {
             mask = bishop_masks[sq] = generate_bishop_mask(sq);
             magic = &bishop_magic_numbers[sq];
-            attacks = bishop_attacks[sq];
+            // Each square's attacks start right after the previous square's
+            attacks = bishop_attacks[sq] =
+                sq == a1 ? slider_attacks : bishop_attacks[sq - 1] + (1 << bishop_masks[sq - 1].popcount());
             n_shifts = bishop_shifts[sq] = 64 - mask.popcount();
         } else {
             mask = rook_masks[sq] = generate_rook_mask(sq);
             magic = &rook_magic_numbers[sq];
-            attacks = rook_attacks[sq];
+            attacks = rook_attacks[sq] = sq == a1 ? slider_attacks + BISHOP_TABLE_SIZE
+                                                  : rook_attacks[sq - 1] + (1 << rook_masks[sq - 1].popcount());
             n_shifts = rook_shifts[sq] = 64 - mask.popcount();
         }
 
@@ -85,6 +91,11 @@ void init_magic_table(PieceType piece_type) {
             blockers = (blockers - mask) & mask;
         } while (blockers);
 
+#if defined(USE_PEXT)
+        // The extracted bits index every subset of the mask exactly once, so there is no magic to search for
+        for (int i = 0; i < size; ++i)
+            attacks[get_attack_index(occupancy[i], mask, *magic, n_shifts)] = reference[i];
+#else
         PRNG prng(seeds[get_rank(sq)]);
 
         // Find a magic for square picking up an (almost) random number
@@ -94,7 +105,7 @@ void init_magic_table(PieceType piece_type) {
                 *magic = prng.sparse_rand<Bitboard::UnderlyingT>();
 
             for (++cnt, i = 0; i < size; ++i) {
-                unsigned idx = get_attack_index(occupancy[i], *magic, n_shifts);
+                unsigned idx = get_attack_index(occupancy[i], mask, *magic, n_shifts);
 
                 if (epoch[idx] < cnt) {
                     epoch[idx] = cnt;
@@ -104,6 +115,7 @@ void init_magic_table(PieceType piece_type) {
                 }
             }
         }
+#endif
     }
 }
 
@@ -21,6 +21,10 @@
 #include <cassert>
 #include <cstdint>
 
+#if defined(USE_PEXT)
+#include <immintrin.h>
+#endif
+
 #include "core/bitboard.h"
 #include "core/types.h"
 
@@ -36,8 +40,14 @@ extern uint64_t rook_magic_numbers[64];
 extern Bitboard pawn_attacks[2][64];
 extern Bitboard knight_attacks[64];
 extern Bitboard king_attacks[64];
-extern Bitboard bishop_attacks[64][512];
-extern Bitboard rook_attacks[64][4096];
+
+// Every square gets exactly 2^popcount(mask) entries, packed into one table shared by both slider types
+constexpr int BISHOP_TABLE_SIZE = 0x1480;
+constexpr int ROOK_TABLE_SIZE = 0x19000;
+extern Bitboard slider_attacks[BISHOP_TABLE_SIZE + ROOK_TABLE_SIZE];
+// indexed as [sq], pointing into slider_attacks
+extern Bitboard *bishop_attacks[64];
+extern Bitboard *rook_attacks[64];
 
 // indexed as [from_sq][to_sq]
 extern Bitboard inbetween_masks[64][64];
@@ -58,15 +68,23 @@ Bitboard generate_bishop_attacks(Square sq, const Bitboard& blockers);
 Bitboard generate_rook_attacks(Square sq, const Bitboard& blockers);
 Bitboard generate_king_attacks(Square sq);
 
-inline int get_attack_index(Bitboard blockers, uint64_t magic, int shift) { return (blockers.raw() * magic) >> shift; }
+/// With BMI2 the relevant occupancy bits are extracted directly, otherwise they are hashed by a magic multiplication
+inline unsigned get_attack_index(const Bitboard& occupancy, const Bitboard& mask, [[maybe_unused]] uint64_t magic,
+                                 [[maybe_unused]] int shift) {
+#if defined(USE_PEXT)
+    return _pext_u64(occupancy.raw(), mask.raw());
+#else
+    return ((occupancy & mask).raw() * magic) >> shift;
+#endif
+}
 
 inline Bitboard get_bishop_attacks(const Square& sq, const Bitboard& occupancy) {
     return bishop_attacks[sq]
-                         [get_attack_index(occupancy & bishop_masks[sq], bishop_magic_numbers[sq], bishop_shifts[sq])];
+                         [get_attack_index(occupancy, bishop_masks[sq], bishop_magic_numbers[sq], bishop_shifts[sq])];
 }
 
 inline Bitboard get_rook_attacks(const Square& sq, const Bitboard& occupancy) {
-    return rook_attacks[sq][get_attack_index(occupancy & rook_masks[sq], rook_magic_numbers[sq], rook_shifts[sq])];
+    return rook_attacks[sq][get_attack_index(occupancy, rook_masks[sq], rook_magic_numbers[sq], rook_shifts[sq])];
 }
 
 inline Bitboard get_queen_attacks(const Square& sq, const Bitboard& occupancy) {
@@ -59,6 +59,7 @@ static inline void push_pawn_promotions(ScoredMoveList& move_list, const Directi
     }
 }
 
+template <GenLegality legality>
 static inline void gen_pawn_noisies(ScoredMoveList& move_list, const Position& pos, Bitboard dst_mask) {
     const Color stm = pos.stm();
     const Color nstm = pos.nstm();
@@ -123,7 +124,7 @@ static inline void gen_pawn_noisies(ScoredMoveList& move_list, const Position& p
         auto ep_discovers_check = [&](Direction capture_offset, Bitboard ep_attacker_bb) -> bool {
             assert(ep_attacker_bb.popcount() <= 1); // at most one pawn can land on ep_sq from a given direction
 
-            if (!ep_attacker_bb)
+            if (!ep_attacker_bb || legality == PSEUDO_LEGAL)
                 return false;
 
             const Square from_sq = static_cast<Square>(ep_attacker_bb.lsb() - static_cast<int>(capture_offset));
@@ -172,11 +173,11 @@ static inline void gen_knights(ScoredMoveList& move_list, const Position& pos, B
     }
 }
 
-template <MoveType move_t>
+template <MoveType move_t, GenLegality legality>
 static inline void gen_sliders(ScoredMoveList& move_list, const Position& pos, Bitboard dst_mask) {
     const Color stm = pos.stm();
     const Bitboard occ = pos.occ_bb();
-    const Bitboard pins = pos.pins_bb();
+    const Bitboard pins = legality == LEGAL ? pos.pins_bb() : Bitboard();
     const Square king_sq = pos.king_sq(stm);
 
     Bitboard queen_bb = pos.piece_bb(QUEEN, stm);
@@ -239,6 +240,7 @@ static inline void gen_castling(ScoredMoveList& move_list, const Position& pos)
     }
 }
 
+template <GenLegality legality>
 void noisies(ScoredMoveList& move_list, const Position& pos) {
     const Color stm = pos.stm();
     const Bitboard king_dst_mask = pos.occ_bb(pos.nstm());
@@ -260,12 +262,13 @@ void noisies(ScoredMoveList& move_list, const Position& pos) {
         pawn_dst_mask |= pawn_push_promotions & inbetween_masks[pos.king_sq(stm)][pos.checkers_bb().lsb()];
     }
 
-    gen_pawn_noisies(move_list, pos, pawn_dst_mask);
+    gen_pawn_noisies<legality>(move_list, pos, pawn_dst_mask);
     gen_knights<CAPTURE>(move_list, pos, dst_mask);
-    gen_sliders<CAPTURE>(move_list, pos, dst_mask);
+    gen_sliders<CAPTURE, legality>(move_list, pos, dst_mask);
     gen_kings<CAPTURE>(move_list, pos, king_dst_mask);
 }
 
+template <GenLegality legality>
 void quiets(ScoredMoveList& move_list, const Position& pos) {
     const Color stm = pos.stm();
     Bitboard king_dst_mask = ~pos.occ_bb();
@@ -284,10 +287,15 @@ void quiets(ScoredMoveList& move_list, const Position& pos) {
 
     gen_pawn_quiets(move_list, pos, dst_mask & ~Bitboard::pawn_promotion_rank(stm));
     gen_knights<REGULAR>(move_list, pos, dst_mask);
-    gen_sliders<REGULAR>(move_list, pos, dst_mask);
+    gen_sliders<REGULAR, legality>(move_list, pos, dst_mask);
     gen_kings<REGULAR>(move_list, pos, king_dst_mask);
 }
 
+template void noisies<LEGAL>(ScoredMoveList& move_list, const Position& pos);
+template void noisies<PSEUDO_LEGAL>(ScoredMoveList& move_list, const Position& pos);
+template void quiets<LEGAL>(ScoredMoveList& move_list, const Position& pos);
+template void quiets<PSEUDO_LEGAL>(ScoredMoveList& move_list, const Position& pos);
+
 void all(ScoredMoveList& move_list, const Position& pos) {
     // Can be done more efficiently than this, but its only used for debugging
     noisies(move_list, pos);
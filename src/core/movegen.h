@@ -27,13 +27,26 @@ namespace Movegen {
 
 using ScoredMoveList = StaticVector<ScoredMove, MAX_MOVES_PER_POS>;
 
-/// Generate all legal noisy moves
+/// PSEUDO_LEGAL skips the tests that cost attack lookups per move: the lines of pinned sliders and the discovered
+/// checks of en passant captures. Those moves must pass Position::is_legal before being played, every other move is
+/// legal in both modes
+enum GenLegality { LEGAL, PSEUDO_LEGAL };
+
+/// Generate all noisy moves
+template <GenLegality legality = LEGAL>
 void noisies(ScoredMoveList& move_list, const Position& pos);
 
-/// Generate all legal quiet moves
+/// Generate all quiet moves
+template <GenLegality legality = LEGAL>
 void quiets(ScoredMoveList& move_list, const Position& pos);
 
 /// Generate all legal moves
 void all(ScoredMoveList& move_list, const Position& pos);
 
+/// Whether a move generated with PSEUDO_LEGAL is legal, only en passant captures and moves of pinned pieces need the
+/// full Position::is_legal test
+inline bool is_legal_pseudo(Position& pos, const Move move) {
+    return !(move.is_ep() || pos.pins_bb().is_set(move.from())) || pos.is_legal(move);
+}
+
 } // namespace Movegen
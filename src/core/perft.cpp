@@ -0,0 +1,146 @@
+/*
+ *  Minke is a UCI chess engine
+ *  Copyright (C) 2026 Eduardo Marinho <eduardomarinho@pm.me>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "core/perft.h"
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "core/movegen.h"
+#include "core/position.h"
+#include "core/types.h"
+
+namespace {
+
+/// Subtree leaf counts shared by all threads without any locking. As in the transposition table, the stored key is
+/// XORed with the count, so an entry torn by two concurrent writes fails the key check instead of returning a wrong
+/// count
+class PerftTable {
+  public:
+    explicit PerftTable(size_t MB) {
+        const size_t entry_count = std::bit_floor(std::max<size_t>(MB * 1024 * 1024 / sizeof(Entry), 1));
+        m_entries = std::make_unique<Entry[]>(entry_count);
+        m_mask = entry_count - 1;
+    }
+
+    bool probe(const HashType hash, const int depth, uint64_t& nodes) const {
+        const HashType key = entry_key(hash, depth);
+        const Entry& entry = m_entries[key & m_mask];
+        nodes = entry.nodes.load(std::memory_order_relaxed);
+        return (entry.key.load(std::memory_order_relaxed) ^ nodes) == key;
+    }
+
+    void store(const HashType hash, const int depth, const uint64_t nodes) {
+        const HashType key = entry_key(hash, depth);
+        Entry& entry = m_entries[key & m_mask];
+        entry.key.store(key ^ nodes, std::memory_order_relaxed);
+        entry.nodes.store(nodes, std::memory_order_relaxed);
+    }
+
+  private:
+    struct Entry {
+        std::atomic<uint64_t> key{0};
+        std::atomic<uint64_t> nodes{0};
+    };
+
+    // The same position has a different count at every depth
+    static HashType entry_key(const HashType hash, const int depth) { return hash ^ (depth * 0x9E3779B97F4A7C15ull); }
+
+    std::unique_ptr<Entry[]> m_entries;
+    size_t m_mask{0};
+};
+
+// Legal moves of 'pos', either generated legal or generated pseudo legal and filtered
+void generate(Movegen::ScoredMoveList& move_list, Position& pos, const Movegen::GenLegality legality) {
+    if (legality == Movegen::LEGAL) {
+        Movegen::all(move_list, pos);
+        return;
+    }
+
+    Movegen::ScoredMoveList pseudo_list;
+    Movegen::noisies<Movegen::PSEUDO_LEGAL>(pseudo_list, pos);
+    Movegen::quiets<Movegen::PSEUDO_LEGAL>(pseudo_list, pos);
+    for (const ScoredMove scored_move : pseudo_list) {
+        if (Movegen::is_legal_pseudo(pos, scored_move.move))
+            move_list.push(scored_move);
+    }
+}
+
+uint64_t count_leaves(Position& pos, const int depth, PerftTable* table, const Movegen::GenLegality legality) {
+    if (depth <= 0)
+        return 1;
+
+    uint64_t nodes;
+    if (depth > 1 && table && table->probe(pos.hash(), depth, nodes))
+        return nodes;
+
+    Movegen::ScoredMoveList move_list;
+    generate(move_list, pos, legality);
+    if (depth == 1)
+        return move_list.size();
+
+    nodes = 0;
+    for (const ScoredMove scored_move : move_list) {
+        pos.make_move(scored_move.move);
+        nodes += count_leaves(pos, depth - 1, table, legality);
+        pos.unmake_move(scored_move.move);
+    }
+
+    if (table)
+        table->store(pos.hash(), depth, nodes);
+    return nodes;
+}
+
+} // namespace
+
+PerftResult perft(const Position& pos, const int depth, const size_t thread_count, const size_t hash_mb,
+                  const Movegen::GenLegality legality) {
+    PerftResult result;
+    Movegen::ScoredMoveList move_list;
+    Movegen::all(move_list, pos);
+    for (const ScoredMove scored_move : move_list)
+        result.divide.emplace_back(scored_move.move, 0);
+
+    std::unique_ptr<PerftTable> table = hash_mb > 0 ? std::make_unique<PerftTable>(hash_mb) : nullptr;
+    std::atomic<size_t> next_move{0};
+    std::vector<std::thread> threads;
+    for (size_t id = 0; id < std::min(std::max<size_t>(thread_count, 1), result.divide.size()); ++id) {
+        threads.emplace_back([&] {
+            // Every thread plays the moves on its own copy of the root position
+            std::unique_ptr<Position> thread_pos = std::make_unique<Position>(pos);
+            for (size_t idx; (idx = next_move.fetch_add(1, std::memory_order_relaxed)) < result.divide.size();) {
+                auto& [move, nodes] = result.divide[idx];
+                thread_pos->make_move(move);
+                nodes = count_leaves(*thread_pos, depth - 1, table.get(), legality);
+                thread_pos->unmake_move(move);
+            }
+        });
+    }
+
+    for (std::thread& thread : threads)
+        thread.join();
+    for (const auto& [move, nodes] : result.divide)
+        result.nodes += nodes;
+    return result;
+}
@@ -0,0 +1,40 @@
+/*
+ *  Minke is a UCI chess engine
+ *  Copyright (C) 2026 Eduardo Marinho <eduardomarinho@pm.me>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "core/move.h"
+#include "core/movegen.h"
+#include "core/position.h"
+
+struct PerftResult {
+    std::vector<std::pair<Move, uint64_t>> divide; // leaf count of every root move, in move generation order
+    uint64_t nodes{0};
+};
+
+/// Counts the leaves of the legal move tree of 'pos' 'depth' plies deep. The root moves are handed out one at a time
+/// to 'thread_count' threads, which share a lock-free table of 'hash_mb' MB with the counts of the subtrees already
+/// visited (0 disables it). Nodes one ply above the leaves count their legal moves instead of playing them. Below the
+/// root, PSEUDO_LEGAL generates the moves the way the MovePicker does and filters them with Position::is_legal
+PerftResult perft(const Position& pos, int depth, size_t thread_count, size_t hash_mb,
+                  Movegen::GenLegality legality = Movegen::LEGAL);
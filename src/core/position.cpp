@@ -97,27 +97,29 @@ bool Position::set_fen(const std::string &fen) {
         return false;
     }
 
+    // Every set of castling rights that includes 'right' can castle with the rook on 'sq'
+    const auto add_castling = [&](const CastlingRights right, const Square sq) {
+        set_bits(m_curr_state.castling_rights, static_cast<uint8_t>(right));
+        for (int rights = NO_CASTLING; rights <= ANY_CASTLING; ++rights) {
+            if (rights & right)
+                m_castle_rooks[rights].set_sq(sq);
+        }
+    };
     for (char castling : fen_arguments[2]) {
         if (castling == 'K') {
-            set_bits(m_curr_state.castling_rights, static_cast<uint8_t>(WHITE_OO));
-            m_curr_state.castle_rooks.set_sq((piece_bb(WHITE_ROOK) & Bitboard::RANK_1).msb());
+            add_castling(WHITE_OO, (piece_bb(WHITE_ROOK) & Bitboard::RANK_1).msb());
         } else if (castling == 'Q') {
-            set_bits(m_curr_state.castling_rights, static_cast<uint8_t>(WHITE_OOO));
-            m_curr_state.castle_rooks.set_sq((piece_bb(WHITE_ROOK) & Bitboard::RANK_1).lsb());
+            add_castling(WHITE_OOO, (piece_bb(WHITE_ROOK) & Bitboard::RANK_1).lsb());
         } else if (castling == 'k') {
-            set_bits(m_curr_state.castling_rights, static_cast<uint8_t>(BLACK_OO));
-            m_curr_state.castle_rooks.set_sq((piece_bb(BLACK_ROOK) & Bitboard::RANK_8).msb());
+            add_castling(BLACK_OO, (piece_bb(BLACK_ROOK) & Bitboard::RANK_8).msb());
         } else if (castling == 'q') {
-            set_bits(m_curr_state.castling_rights, static_cast<uint8_t>(BLACK_OOO));
-            m_curr_state.castle_rooks.set_sq((piece_bb(BLACK_ROOK) & Bitboard::RANK_8).lsb());
+            add_castling(BLACK_OOO, (piece_bb(BLACK_ROOK) & Bitboard::RANK_8).lsb());
         } else if ('A' <= castling && castling <= 'H') {
             Square sq = get_square(castling - 'A', 0);
-            set_bits(m_curr_state.castling_rights, static_cast<uint8_t>(king_sq(WHITE) > sq ? WHITE_OOO : WHITE_OO));
-            m_curr_state.castle_rooks.set_sq(sq);
+            add_castling(king_sq(WHITE) > sq ? WHITE_OOO : WHITE_OO, sq);
         } else if ('a' <= castling && castling <= 'h') {
             Square sq = get_square(castling - 'a', 7);
-            set_bits(m_curr_state.castling_rights, static_cast<uint8_t>(king_sq(BLACK) > sq ? BLACK_OOO : BLACK_OO));
-            m_curr_state.castle_rooks.set_sq(sq);
+            add_castling(king_sq(BLACK) > sq ? BLACK_OOO : BLACK_OO, sq);
         }
     }
 
@@ -235,6 +237,9 @@ void Position::reset() {
         m_occupancies[i] = Bitboard::EMPTY;
     }
 
+    for (Bitboard &castle_rooks : m_castle_rooks)
+        castle_rooks = Bitboard::EMPTY;
+
     m_history_ply = 0;
     m_curr_state.reset();
 }
@@ -433,19 +438,15 @@ void Position::update_castling_rights(const Move &move) {
         switch (m_stm) {
             case WHITE:
                 unset_mask(m_curr_state.castling_rights, static_cast<uint8_t>(WHITE_CASTLING));
-                m_curr_state.castle_rooks.unset_mask(Bitboard::RANK_1);
                 break;
             case BLACK:
                 unset_mask(m_curr_state.castling_rights, static_cast<uint8_t>(BLACK_CASTLING));
-                m_curr_state.castle_rooks.unset_mask(Bitboard::RANK_8);
                 break;
             default:
                 __builtin_unreachable();
         }
     } else if (moved_piece_type == ROOK) { // Moved rook
-        if (m_curr_state.castle_rooks.is_set(from)) {
-            m_curr_state.castle_rooks.unset_sq(from);
-
+        if (castle_rooks_bb().is_set(from)) {
             if (from > king_sq(stm())) {
                 unset_mask(m_curr_state.castling_rights, static_cast<uint8_t>(stm() == WHITE ? WHITE_OO : BLACK_OO));
             } else {
@@ -454,8 +455,7 @@ void Position::update_castling_rights(const Move &move) {
         }
     }
     if (get_piece_type(m_curr_state.captured) == ROOK) { // Captured rook
-        if (m_curr_state.castle_rooks.is_set(to)) {
-            m_curr_state.castle_rooks.unset_sq(to);
+        if (castle_rooks_bb().is_set(to)) {
             if (to > king_sq(nstm())) {
                 unset_mask(m_curr_state.castling_rights, static_cast<uint8_t>(nstm() == WHITE ? WHITE_OO : BLACK_OO));
             } else {
@@ -804,7 +804,7 @@ bool Position::castling_pseudo_legal(const Square &from, const Square &to, const
     const uint8_t castling_right =
         (castling_long) ? (m_stm == WHITE ? WHITE_OOO : BLACK_OOO) : (m_stm == WHITE ? WHITE_OO : BLACK_OO);
 
-    if (!(castling_rights() & castling_right) || !m_curr_state.castle_rooks.is_set(rook_from))
+    if (!(castling_rights() & castling_right) || !castle_rooks_bb().is_set(rook_from))
         return false;
 
     const Bitboard crossing_mask = (inbetween_masks[king_from][king_to] | inbetween_masks[rook_from][rook_to] |
@@ -28,39 +28,42 @@
 #include "eval/nnue.h"
 #include "types.h"
 
-struct BoardState {
-    Piece captured;
-    int fifty_move_ply;
-    int ply_from_null;
-    uint8_t castling_rights;
-    Square en_passant;
-    Bitboard checkers;
-    Bitboard pins;
-    Bitboard castle_rooks;
-    Bitboard threats;
-
+/// The state every make_move saves on the history stack, packed into one cache line. The squares of the castling
+/// rooks only change with a new position, so they live in Position instead, selected by the castling rights
+struct alignas(64) BoardState {
     HashType position_hash;
     HashType pawn_hash;
     HashType white_non_pawn_hash;
     HashType black_non_pawn_hash;
 
+    Bitboard checkers;
+    Bitboard pins;
+    Bitboard threats;
+
+    int16_t fifty_move_ply;
+    int16_t ply_from_null;
+    uint8_t castling_rights;
+    Piece captured : 8;
+    Square en_passant : 8;
+
     void reset() {
+        position_hash = 0ull;
+        pawn_hash = 0ull;
+        white_non_pawn_hash = 0ull;
+        black_non_pawn_hash = 0ull;
+
         checkers = 0;
         pins = 0;
-        captured = EMPTY;
+        threats = 0;
+
         fifty_move_ply = 0;
         ply_from_null = 0;
         castling_rights = NO_CASTLING;
+        captured = EMPTY;
         en_passant = NO_SQ;
-        castle_rooks = 0;
-        threats = 0;
-
-        position_hash = 0ull;
-        pawn_hash = 0ull;
-        white_non_pawn_hash = 0ull;
-        black_non_pawn_hash = 0ull;
     }
 };
+static_assert(sizeof(BoardState) == 64, "BoardState doesn't fit in a cache line");
 
 class Position {
   public:
@@ -130,11 +133,11 @@ class Position {
     inline int piece_count() const { return occ_bb().popcount(); }
     inline Piece piece_at(const Square &sq) const { return m_board[sq]; }
     inline int history_ply() const { return m_history_ply; }
-    inline BoardState board_state() const { return m_curr_state; };
+    inline const BoardState &board_state() const { return m_curr_state; };
     inline BoardState &board_state() { return m_curr_state; };
     inline Bitboard checkers_bb() const { return m_curr_state.checkers; }
     inline Bitboard pins_bb() const { return m_curr_state.pins; }
-    inline Bitboard castle_rooks_bb() const { return m_curr_state.castle_rooks; }
+    inline Bitboard castle_rooks_bb() const { return m_castle_rooks[m_curr_state.castling_rights]; }
     inline void reset_history() { m_history_ply = 0; }
 
     // if there is more that 100 positions in the game history stacks, clean up the first ones by shift the array
@@ -179,16 +182,18 @@ class Position {
 
     inline void change_side() { m_stm = static_cast<Color>(m_stm ^ 1); }
 
-    Piece m_board[64];
+    BoardState m_curr_state;
     Bitboard m_occupancies[2];
     Bitboard m_pieces[12];
+    Piece m_board[64];
 
     Color m_stm;
     int m_game_clock_ply;
-
     int m_history_ply;
-    BoardState m_curr_state;
-    BoardState m_history_stack[MAX_PLY];
-
     bool m_chess960{false};
+
+    // Indexed by castling rights, the rooks that can still castle
+    Bitboard m_castle_rooks[ANY_CASTLING + 1];
+
+    BoardState m_history_stack[MAX_PLY];
 };
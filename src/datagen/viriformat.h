@@ -20,6 +20,7 @@
 
 #include <cstdint>
 #include <fstream>
+#include <vector>
 
 #include "core/move.h"
 #include "core/position.h"
@@ -0,0 +1,46 @@
+/*
+ *  Minke is a UCI chess engine
+ *  Copyright (C) 2026 Eduardo Marinho <eduardomarinho@pm.me>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "eval/eval_cache.h"
+
+#include <bit>
+#include <cstring>
+
+#include "utils/utils.h"
+
+EvalCache::~EvalCache() { aligned_free(m_buckets); }
+
+void EvalCache::resize(size_t MB) {
+    aligned_free(m_buckets);
+    m_buckets = nullptr;
+    m_mask = 0;
+    m_size_mb = MB;
+    if (MB == 0)
+        return;
+
+    const size_t bucket_count = std::bit_floor(MB * 1024 * 1024 / sizeof(Bucket));
+    m_buckets = static_cast<Bucket *>(aligned_malloc(alignof(Bucket), bucket_count * sizeof(Bucket)));
+    m_mask = bucket_count - 1;
+    clear();
+}
+
+void EvalCache::clear() {
+    if (m_buckets != nullptr)
+        std::memset(static_cast<void *>(m_buckets), 0, (m_mask + 1) * sizeof(Bucket));
+    reset_stats();
+}
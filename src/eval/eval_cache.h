@@ -0,0 +1,88 @@
+/*
+ *  Minke is a UCI chess engine
+ *  Copyright (C) 2026 Eduardo Marinho <eduardomarinho@pm.me>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "core/types.h"
+
+/// Small set-associative cache of raw network outputs, private to one search thread. A hit skips both the accumulator
+/// update and the forward pass
+class EvalCache {
+  public:
+    EvalCache() = default;
+    EvalCache(const EvalCache &) = delete;
+    ~EvalCache();
+
+    EvalCache &operator=(const EvalCache &) = delete;
+
+    /// Resizes to at most 'MB' mebibytes, rounded down to a power of two number of buckets. 0 disables the cache
+    void resize(size_t MB);
+    void clear();
+
+    inline bool probe(const HashType hash, ScoreType &eval) {
+        if (m_buckets == nullptr)
+            return false;
+
+        ++m_probes;
+        const Bucket &bucket = m_buckets[hash & m_mask];
+        const uint32_t key = hash >> 32;
+        for (size_t idx = 0; idx < BUCKET_SIZE; ++idx) {
+            if (bucket.keys[idx] == key) {
+                eval = bucket.evals[idx];
+                ++m_hits;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /// The newest entry goes first and the oldest one of the bucket is dropped
+    inline void store(const HashType hash, const ScoreType eval) {
+        if (m_buckets == nullptr)
+            return;
+
+        Bucket &bucket = m_buckets[hash & m_mask];
+        for (size_t idx = BUCKET_SIZE - 1; idx > 0; --idx) {
+            bucket.keys[idx] = bucket.keys[idx - 1];
+            bucket.evals[idx] = bucket.evals[idx - 1];
+        }
+        bucket.keys[0] = hash >> 32;
+        bucket.evals[0] = eval;
+    }
+
+    inline void reset_stats() { m_probes = m_hits = 0; }
+    inline int64_t probes() const { return m_probes; }
+    inline int64_t hits() const { return m_hits; }
+    inline size_t size_mb() const { return m_size_mb; }
+
+  private:
+    static constexpr size_t BUCKET_SIZE = 4;
+    struct alignas(32) Bucket {
+        uint32_t keys[BUCKET_SIZE];
+        ScoreType evals[BUCKET_SIZE];
+    };
+
+    Bucket *m_buckets = nullptr;
+    size_t m_mask = 0;
+    size_t m_size_mb = 0;
+    int64_t m_probes = 0;
+    int64_t m_hits = 0;
+};
@@ -27,8 +27,8 @@
 #include "eval/nnue/accumulator.h"
 #include "eval/nnue/arch.h"
 #include "eval/nnue/finny_table.h"
+#include "eval/nnue/forward.h"
 #include "eval/nnue/pov_accumulator.h"
-#include "eval/nnue/sparse_iterator.h"
 
 class Position;
 
@@ -39,11 +39,15 @@ class NNUE {
     ~NNUE() = default;
 
     void refresh(const Position &pos);
+    /// Drops every cached accumulator, which become stale when the network changes. Must be refreshed afterwards
+    void reset();
 
     void pop();
     void push(const DirtyPiece &dp, const Square white_king_sq, const Square black_king_sq);
 
     ScoreType eval(const Position &pos);
+    /// Evaluates independent positions together, for offline tooling. Leaves the accumulator stack untouched
+    void eval_batch(std::span<const Position *const> positions, std::span<ScoreType> scores);
 
 #ifdef TRACK_ACTIVATIONS
     const std::array<size_t, PAIR_COUNT> &activation_table();
@@ -56,13 +60,6 @@ class NNUE {
     int32_t propagate(std::span<const int16_t, L1_SIZE> stm_inputs, std::span<const int16_t, L1_SIZE> ntm_inputs,
                       const int bucket);
 
-    void activate_ft(std::span<const int16_t, L1_SIZE> stm_acc, std::span<const int16_t, L1_SIZE> ntm_acc,
-                     std::span<uint8_t, L1_SIZE> outputs, SparseIterator &si);
-    void propagate_l1(int bucket, std::span<const uint8_t, L1_SIZE> inputs, std::span<int32_t, ACTUAL_L2_SIZE> outputs,
-                      const SparseIterator &si);
-    void propagate_l2(int bucket, std::span<const int32_t, ACTUAL_L2_SIZE> inputs, std::span<int32_t, L3_SIZE> outputs);
-    void propagate_l3(int bucket, std::span<const int32_t, L3_SIZE> inputs, int32_t &output);
-
 #ifdef TRACK_ACTIVATIONS
 
     void track_activations(std::span<const uint8_t, L1_SIZE> ft_out);
@@ -72,5 +69,10 @@ class NNUE {
 #endif // TRACK_ACTIVATIONS
 
     FinnyTable m_finny_table;
-    std::vector<Accumulator> m_accumulators;
+    AccumulatorStack m_accumulators;
+
+    // Scratch space of eval_batch, kept to avoid allocating on every call
+    std::vector<PovAccumulator> m_batch_accumulators; // side to move's then the other side's, of every position
+    std::vector<Forward::Input> m_batch_inputs;
+    std::vector<int32_t> m_batch_outputs;
 };
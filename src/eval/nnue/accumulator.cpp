@@ -18,8 +18,12 @@
 
 #include "eval/nnue/accumulator.h"
 
+#include <cstring>
+#include <type_traits>
+
 #include "core/types.h"
 #include "eval/nnue/pov_accumulator.h"
+#include "utils/utils.h"
 
 Accumulator::Accumulator(const Square white_king_sq, const Square black_king_sq, const PovAccumulator &white_pov_acc,
                          const PovAccumulator &black_pov_acc)
@@ -75,6 +79,54 @@ void Accumulator::update(const Color pov, const PovAccumulator &prev_pov_acc) {
     m_updated[pov] = true;
 }
 
+void Accumulator::update_both(const Accumulator &prev) {
+    // clang-format off
+    const size_t add0[2] = {feature_idx(m_dirty_piece.add0, m_king_sqs[WHITE], WHITE),
+                            feature_idx(m_dirty_piece.add0, m_king_sqs[BLACK], BLACK)};
+    const size_t sub0[2] = {feature_idx(m_dirty_piece.sub0, m_king_sqs[WHITE], WHITE),
+                            feature_idx(m_dirty_piece.sub0, m_king_sqs[BLACK], BLACK)};
+    switch (m_dirty_piece.move_type) {
+        case ADD_SUB:
+            PovAccumulator::add_sub_dual(m_pov_accumulators, prev.m_pov_accumulators, add0, sub0);
+            break;
+        case ADD_SUB2: {
+            const size_t sub1[2] = {feature_idx(m_dirty_piece.sub1, m_king_sqs[WHITE], WHITE),
+                                    feature_idx(m_dirty_piece.sub1, m_king_sqs[BLACK], BLACK)};
+            PovAccumulator::add_sub2_dual(m_pov_accumulators, prev.m_pov_accumulators, add0, sub0, sub1);
+            break;
+        }
+        case ADD2_SUB2: {
+            const size_t add1[2] = {feature_idx(m_dirty_piece.add1, m_king_sqs[WHITE], WHITE),
+                                    feature_idx(m_dirty_piece.add1, m_king_sqs[BLACK], BLACK)};
+            const size_t sub1[2] = {feature_idx(m_dirty_piece.sub1, m_king_sqs[WHITE], WHITE),
+                                    feature_idx(m_dirty_piece.sub1, m_king_sqs[BLACK], BLACK)};
+            PovAccumulator::add2_sub2_dual(m_pov_accumulators, prev.m_pov_accumulators, add0, add1, sub0, sub1);
+            break;
+        }
+        default:
+            assert(false);
+            __builtin_unreachable();
+    }
+    // clang-format on
+
+    m_updated[WHITE] = m_updated[BLACK] = true;
+}
+
+void Accumulator::collect(const Color pov, FeatureDelta &delta) const {
+    delta.add(feature_idx(m_dirty_piece.add0, m_king_sqs[pov], pov));
+    delta.sub(feature_idx(m_dirty_piece.sub0, m_king_sqs[pov], pov));
+    if (m_dirty_piece.move_type == ADD2_SUB2)
+        delta.add(feature_idx(m_dirty_piece.add1, m_king_sqs[pov], pov));
+    if (m_dirty_piece.move_type == ADD_SUB2 || m_dirty_piece.move_type == ADD2_SUB2)
+        delta.sub(feature_idx(m_dirty_piece.sub1, m_king_sqs[pov], pov));
+}
+
+void Accumulator::catch_up(const Color pov, const PovAccumulator &base_pov_acc, const FeatureDelta &delta) {
+    m_pov_accumulators[pov].apply(base_pov_acc, {delta.adds.begin(), delta.adds.size()},
+                                  {delta.subs.begin(), delta.subs.size()});
+    m_updated[pov] = true;
+}
+
 bool Accumulator::needs_refresh(const Color pov, const Square new_king_sq) const {
     return (new_king_sq & 0b100) != (m_king_sqs[pov] & 0b100) ||                       // King crossed half of the board
            king_bucket_idx(new_king_sq, pov) != king_bucket_idx(m_king_sqs[pov], pov); // King bucket change
@@ -97,3 +149,43 @@ bool operator==(const Accumulator &lhs, const Accumulator &rhs) {
 
     return true;
 }
+
+void FeatureDelta::add(const size_t feature) {
+    for (size_t idx = 0; idx < subs.size(); ++idx) {
+        if (subs[idx] == feature) {
+            subs[idx] = subs.back();
+            subs.pop();
+            return;
+        }
+    }
+    adds.push(feature);
+}
+
+void FeatureDelta::sub(const size_t feature) {
+    for (size_t idx = 0; idx < adds.size(); ++idx) {
+        if (adds[idx] == feature) {
+            adds[idx] = adds.back();
+            adds.pop();
+            return;
+        }
+    }
+    subs.push(feature);
+}
+
+// Accumulators are copied with memcpy and never destroyed
+static_assert(std::is_trivially_copyable_v<Accumulator>);
+
+AccumulatorStack::AccumulatorStack()
+    : m_arena(static_cast<Accumulator *>(aligned_malloc(alignof(Accumulator), MAX_PLY * sizeof(Accumulator)))) {}
+
+AccumulatorStack::AccumulatorStack(const AccumulatorStack &other) : AccumulatorStack() { *this = other; }
+
+AccumulatorStack::~AccumulatorStack() { aligned_free(m_arena); }
+
+AccumulatorStack &AccumulatorStack::operator=(const AccumulatorStack &other) {
+    if (this != &other) {
+        std::memcpy(static_cast<void *>(m_arena), other.m_arena, other.m_size * sizeof(Accumulator));
+        m_size = other.m_size;
+    }
+    return *this;
+}
@@ -18,11 +18,26 @@
 
 #pragma once
 
+#include <cassert>
+#include <cstddef>
+#include <new>
+#include <utility>
+
 #include "core/types.h"
 #include "eval/nnue/pov_accumulator.h"
+#include "utils/static_vector.h"
 
 class Position;
 
+/// Net feature change of several plies, where adding and removing the same feature cancel each other out
+struct FeatureDelta {
+    StaticVector<size_t, 2 * MAX_PLY> adds;
+    StaticVector<size_t, 2 * MAX_PLY> subs;
+
+    void add(const size_t feature);
+    void sub(const size_t feature);
+};
+
 class alignas(64) Accumulator {
   public:
     Accumulator() = delete;
@@ -32,6 +47,12 @@ class alignas(64) Accumulator {
     ~Accumulator() = default;
 
     void update(const Color pov, const PovAccumulator &prev_pov_acc);
+    /// Updates both perspectives in a single pass, 'prev' must be up to date for both and not need a refresh
+    void update_both(const Accumulator &prev);
+    /// Adds the feature changes of this ply to 'delta'
+    void collect(const Color pov, FeatureDelta &delta) const;
+    /// Updates from the accumulator several plies behind, 'delta' holding the changes of every ply in between
+    void catch_up(const Color pov, const PovAccumulator &base_pov_acc, const FeatureDelta &delta);
     inline bool updated(const Color pov) const { return m_updated[pov]; }
 
     bool needs_refresh(const Color side, const Square new_king_sq) const;
@@ -49,3 +70,37 @@ class alignas(64) Accumulator {
     Square m_king_sqs[2];
     DirtyPiece m_dirty_piece;
 };
+
+/// Accumulators of the line being searched, one per ply. The arena is allocated once, so pushing never reallocates
+/// or moves the accumulators below, and copying only copies the plies in use
+class AccumulatorStack {
+  public:
+    AccumulatorStack();
+    AccumulatorStack(const AccumulatorStack &other);
+    ~AccumulatorStack();
+
+    AccumulatorStack &operator=(const AccumulatorStack &other);
+
+    template <typename... Args>
+    inline Accumulator &emplace_back(Args &&...args) {
+        assert(m_size < MAX_PLY);
+        return *new (&m_arena[m_size++]) Accumulator(std::forward<Args>(args)...);
+    }
+    inline void pop_back() {
+        assert(m_size > 0);
+        --m_size;
+    }
+    inline void clear() { m_size = 0; }
+
+    inline bool empty() const { return m_size == 0; }
+    inline size_t size() const { return m_size; }
+
+    inline Accumulator &operator[](const size_t ply) { return m_arena[ply]; }
+    inline const Accumulator &operator[](const size_t ply) const { return m_arena[ply]; }
+    inline Accumulator &back() { return m_arena[m_size - 1]; }
+    inline const Accumulator &back() const { return m_arena[m_size - 1]; }
+
+  private:
+    Accumulator *m_arena;
+    size_t m_size = 0;
+};
@@ -0,0 +1,97 @@
+/*
+ *  Minke is a UCI chess engine
+ *  Copyright (C) 2026 Eduardo Marinho <eduardomarinho@pm.me>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "eval/nnue/activations.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "core/position.h"
+#include "core/types.h"
+#include "eval/nnue/arch.h"
+#include "eval/nnue/dispatch.h"
+#include "eval/nnue/forward.h"
+#include "eval/nnue/pov_accumulator.h"
+
+void ActivationStats::add(std::span<const uint8_t, L1_SIZE> ft_outputs) {
+    for (size_t idx = 0; idx < L1_SIZE; ++idx) {
+        if (ft_outputs[idx] != 0)
+            ++counts[idx % PAIR_COUNT];
+    }
+    for (size_t chunk = 0; chunk < L1_SIZE; chunk += 4)
+        nnz_chunks += (ft_outputs[chunk] | ft_outputs[chunk + 1] | ft_outputs[chunk + 2] | ft_outputs[chunk + 3]) != 0;
+    ++positions;
+}
+
+void ActivationStats::merge(const ActivationStats &other) {
+    for (size_t idx = 0; idx < PAIR_COUNT; ++idx)
+        counts[idx] += other.counts[idx];
+    positions += other.positions;
+    nnz_chunks += other.nnz_chunks;
+}
+
+bool ActivationStats::write(const std::string &path) const {
+    std::ofstream out_file(path);
+    if (!out_file)
+        return false;
+
+    for (size_t idx = 0; idx < PAIR_COUNT; ++idx)
+        out_file << (idx == 0 ? "" : ", ") << counts[idx];
+    out_file << '\n';
+    return static_cast<bool>(out_file);
+}
+
+ActivationStats collect_activations(const std::vector<std::string> &fens, int thread_count) {
+    thread_count = std::max(thread_count, 1);
+    std::vector<ActivationStats> thread_stats(thread_count);
+    std::vector<std::thread> threads;
+    for (int id = 0; id < thread_count; ++id) {
+        threads.emplace_back([&, id] {
+            std::unique_ptr<Position> pos = std::make_unique<Position>();
+            alignas(64) uint8_t ft_buffer[L1_SIZE];
+            const std::span<uint8_t, L1_SIZE> ft_outputs(ft_buffer);
+
+            for (size_t idx = id; idx < fens.size(); idx += thread_count) {
+                if (!pos->set_fen(fens[idx]))
+                    continue;
+
+                const PovAccumulator stm_acc(*pos, pos->stm()), ntm_acc(*pos, pos->nstm());
+                const int bucket = (pos->piece_count() - 2) / BUCKET_SIZE;
+#if USE_DISPATCH
+                Dispatch::kernels().propagate(stm_acc.neurons(), ntm_acc.neurons(), bucket, ft_outputs);
+#else
+                Forward::propagate(stm_acc.neurons(), ntm_acc.neurons(), bucket, ft_outputs);
+#endif
+                thread_stats[id].add(ft_outputs);
+            }
+        });
+    }
+
+    ActivationStats stats;
+    for (int id = 0; id < thread_count; ++id) {
+        threads[id].join();
+        stats.merge(thread_stats[id]);
+    }
+    return stats;
+}
@@ -0,0 +1,45 @@
+/*
+ *  Minke is a UCI chess engine
+ *  Copyright (C) 2026 Eduardo Marinho <eduardomarinho@pm.me>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "eval/nnue/arch.h"
+
+/// How often every feature transformer output of the current net is non-zero over a set of positions. preprocess_nnue
+/// orders the neurons by these counts, so that rarely active ones share the 4-byte chunks the sparse L1 matmul skips
+struct ActivationStats {
+    std::array<uint64_t, PAIR_COUNT> counts{}; // times each neuron pair was active, for either perspective
+    uint64_t positions = 0;
+    uint64_t nnz_chunks = 0; // non-zero 4-byte chunks of the L1 input, summed over every position
+
+    void add(std::span<const uint8_t, L1_SIZE> ft_outputs);
+    void merge(const ActivationStats &other);
+    double average_nnz() const { return positions == 0 ? 0.0 : static_cast<double>(nnz_chunks) / positions; }
+
+    /// Writes the counts as a comma separated list, the format preprocess_nnue reads
+    bool write(const std::string &path) const;
+};
+
+/// Evaluates every position of 'fens' with the current net, split across 'thread_count' threads
+ActivationStats collect_activations(const std::vector<std::string> &fens, int thread_count);
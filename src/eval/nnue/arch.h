@@ -18,6 +18,7 @@
 
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
 
 #include "core/types.h"
@@ -62,8 +63,9 @@ constexpr int32_t QC = 64;
 constexpr int32_t FT_SCALE_BITS = 7;
 constexpr int32_t QC_BITS = 6;
 
-struct alignas(64) Network {
-    int16_t ft_weights[NUM_KING_BUCKETS * INPUT_LAYER_SIZE * L1_SIZE];
+template <typename FT_WEIGHT>
+struct alignas(64) NetworkLayout {
+    FT_WEIGHT ft_weights[NUM_KING_BUCKETS * INPUT_LAYER_SIZE * L1_SIZE];
     int16_t ft_biases[L1_SIZE];
     int8_t l1_weights[OUTPUT_BUCKET_COUNT][L1_SIZE / 4][L2_SIZE][4];
     int32_t l1_biases[OUTPUT_BUCKET_COUNT][L2_SIZE];
@@ -72,7 +74,45 @@ struct alignas(64) Network {
     int32_t l3_weights[OUTPUT_BUCKET_COUNT][L3_SIZE];
     int32_t l3_biases[OUTPUT_BUCKET_COUNT];
 };
-extern Network network;
+
+/// Layout of the nets as trained
+using FullNetwork = NetworkLayout<int16_t>;
+
+#if USE_FT_INT8
+/// Feature transformer weights in int8, scaled per feature, which halves the memory traffic of accumulator updates
+struct alignas(64) Network : NetworkLayout<int8_t> {
+    int16_t ft_scales[NUM_KING_BUCKETS * INPUT_LAYER_SIZE];
+};
+#else
+using Network = FullNetwork;
+#endif
+extern const Network *network;
+
+constexpr char NETWORK_MAGIC[8] = {'M', 'I', 'N', 'K', 'E', 'N', 'E', 'T'};
+
+/// Appended to processed nets, so that a net processed for another build is rejected instead of evaluated with the
+/// wrong layout
+struct NetworkTrailer {
+    char magic[8];
+    uint32_t ft_weight_size;    // bytes of every feature transformer weight
+    uint32_t packus_lane_count; // feature transformer columns are reordered in groups of this many 128-bit chunks
+    uint8_t packus_lane_order[8];
+    uint64_t permutation_hash; // of the neuron order chosen for sparsity, 0 if the neurons keep their trained order
+
+    bool same_packus_layout(const size_t lane_count, const size_t *lane_order) const {
+        if (packus_lane_count != lane_count)
+            return false;
+        for (size_t lane = 0; lane < lane_count; ++lane) {
+            if (packus_lane_order[lane] != lane_order[lane])
+                return false;
+        }
+        return true;
+    }
+};
+static_assert(sizeof(NetworkTrailer) == 32);
+
+/// Trailer of the net in use
+extern const NetworkTrailer *network_trailer;
 
 /// Check whether king has crossed half of the board, i.e. if the board should be flipped for horizontal mirroring
 inline bool should_flip(const Square king_sq) { return get_file(king_sq) > 3; }
@@ -0,0 +1,183 @@
+/*
+ *  Minke is a UCI chess engine
+ *  Copyright (C) 2026 Eduardo Marinho <eduardomarinho@pm.me>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#if USE_DISPATCH
+
+#include "eval/nnue/dispatch.h"
+
+#include <array>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include "eval/nnue/arch.h"
+#include "eval/nnue/forward.h"
+#include "eval/nnue/update.h"
+#include "utils/utils.h"
+
+// The kernels of every instruction set, each compiled from forward.cpp with its own SIMD_ISA
+namespace Forward {
+inline namespace scalar {
+extern const Kernels kernels;
+}
+inline namespace avx2 {
+extern const Kernels kernels;
+}
+inline namespace avxvnni {
+extern const Kernels kernels;
+}
+inline namespace avx512 {
+extern const Kernels kernels;
+}
+inline namespace vnni512 {
+extern const Kernels kernels;
+}
+} // namespace Forward
+
+// The accumulator updates of every instruction set, each compiled from update.cpp with its own SIMD_ISA
+namespace Update {
+inline namespace scalar {
+extern const Kernels kernels;
+}
+inline namespace avx2 {
+extern const Kernels kernels;
+}
+inline namespace avxvnni {
+extern const Kernels kernels;
+}
+inline namespace avx512 {
+extern const Kernels kernels;
+}
+inline namespace vnni512 {
+extern const Kernels kernels;
+}
+} // namespace Update
+
+namespace Dispatch {
+
+struct Level {
+    const char *name;
+    bool (*supported)();
+    const Forward::Kernels &kernels;
+    const Update::Kernels &update_kernels;
+};
+
+// Best first, the scalar kernels run anywhere
+// clang-format off
+static const Level LEVELS[] = {
+    {"vnni512",
+     [] {
+         return __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw") &&
+                __builtin_cpu_supports("avx512vnni");
+     },
+     Forward::vnni512::kernels, Update::vnni512::kernels},
+    {"avx512",
+     [] { return __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw"); },
+     Forward::avx512::kernels, Update::avx512::kernels},
+    {"avxvnni",
+     [] {
+         return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("bmi2") &&
+                __builtin_cpu_supports("avxvnni");
+     },
+     Forward::avxvnni::kernels, Update::avxvnni::kernels},
+    {"avx2",
+     [] { return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("bmi2"); },
+     Forward::avx2::kernels, Update::avx2::kernels},
+    {"scalar",
+     [] { return true; },
+     Forward::scalar::kernels, Update::scalar::kernels},
+};
+// clang-format on
+
+static const Level *selected = nullptr;
+static Network *converted = nullptr;
+
+void init() {
+    __builtin_cpu_init();
+    for (const Level &level : LEVELS) {
+        if (level.supported()) {
+            selected = &level;
+            break;
+        }
+    }
+}
+
+const char *isa_name() { return selected->name; }
+
+const Forward::Kernels &kernels() { return selected->kernels; }
+
+const Update::Kernels &update_kernels() { return selected->update_kernels; }
+
+/// Moves chunks of 8 columns of 'values', 128 bits in int16, from the packus order of 'from' into the one of 'to'
+template <typename T>
+static void convert_ft_layout(T *values, size_t count, const Forward::Kernels &from, const Forward::Kernels &to) {
+    using Chunk = std::array<T, 8>;
+    Chunk *chunks = reinterpret_cast<Chunk *>(values);
+    const size_t chunk_count = count / 8;
+    assert(chunk_count % from.packus_lane_count == 0 && chunk_count % to.packus_lane_count == 0);
+
+    std::array<Chunk, 8> temp;
+    for (size_t i = 0; i < chunk_count; i += from.packus_lane_count) {
+        for (size_t j = 0; j < from.packus_lane_count; ++j)
+            temp[from.packus_lane_order[j]] = chunks[i + j];
+        for (size_t j = 0; j < from.packus_lane_count; ++j)
+            chunks[i + j] = temp[j];
+    }
+    for (size_t i = 0; i < chunk_count; i += to.packus_lane_count) {
+        for (size_t j = 0; j < to.packus_lane_count; ++j)
+            temp[j] = chunks[i + j];
+        for (size_t j = 0; j < to.packus_lane_count; ++j)
+            chunks[i + j] = temp[to.packus_lane_order[j]];
+    }
+}
+
+/// The kernels whose packus the net with 'trailer' is laid out for, if any
+static const Forward::Kernels *find_layout(const NetworkTrailer &trailer) {
+    for (const Level &level : LEVELS) {
+        if (trailer.same_packus_layout(level.kernels.packus_lane_count, level.kernels.packus_lane_order))
+            return &level.kernels;
+    }
+    return nullptr;
+}
+
+bool known_layout(const NetworkTrailer &trailer) { return find_layout(trailer) != nullptr; }
+
+const Network *adapt_network(const Network *net, const NetworkTrailer &trailer) {
+    assert(selected != nullptr);
+    if (converted != nullptr) {
+        aligned_free(converted);
+        converted = nullptr;
+    }
+
+    const Forward::Kernels *layout = find_layout(trailer);
+    const Forward::Kernels &target = selected->kernels;
+    assert(layout != nullptr);
+    if (trailer.same_packus_layout(target.packus_lane_count, target.packus_lane_order))
+        return net;
+
+    converted = static_cast<Network *>(aligned_malloc(alignof(Network), sizeof(Network)));
+    std::memcpy(static_cast<void *>(converted), net, sizeof(Network));
+    convert_ft_layout(converted->ft_weights, std::size(converted->ft_weights), *layout, target);
+    convert_ft_layout(converted->ft_biases, std::size(converted->ft_biases), *layout, target);
+    return converted;
+}
+
+} // namespace Dispatch
+
+#endif // USE_DISPATCH
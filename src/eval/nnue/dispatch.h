@@ -0,0 +1,50 @@
+/*
+ *  Minke is a UCI chess engine
+ *  Copyright (C) 2026 Eduardo Marinho <eduardomarinho@pm.me>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#if USE_DISPATCH
+
+#include "eval/nnue/arch.h"
+#include "eval/nnue/forward.h"
+#include "eval/nnue/update.h"
+
+/// Single binary builds compile the forward pass and the accumulator updates once per instruction set and pick the best
+/// one the CPU supports
+namespace Dispatch {
+
+/// Selects the kernels, must run before any network is used
+void init();
+
+/// Name of the instruction set whose kernels were selected
+const char *isa_name();
+
+const Forward::Kernels &kernels();
+
+const Update::Kernels &update_kernels();
+
+/// Whether a net with 'trailer' is laid out for the packus of any of the kernels, which adapt_network can convert from
+bool known_layout(const NetworkTrailer &trailer);
+
+/// Returns 'net' itself if its feature transformer, laid out as 'trailer' records, fits the selected kernels, otherwise
+/// a converted copy, which stays valid until the next call
+const Network *adapt_network(const Network *net, const NetworkTrailer &trailer);
+
+} // namespace Dispatch
+
+#endif // USE_DISPATCH
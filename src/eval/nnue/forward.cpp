@@ -0,0 +1,473 @@
+/*
+ *  Minke is a UCI chess engine
+ *  Copyright (C) 2026 Eduardo Marinho <eduardomarinho@pm.me>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "eval/nnue/forward.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include "eval/nnue/arch.h"
+#include "eval/nnue/simd.h"
+#include "eval/nnue/sparse_iterator.h"
+#include "utils/utils.h"
+
+namespace Forward {
+inline namespace SIMD_ISA {
+
+int32_t propagate(std::span<const int16_t, L1_SIZE> stm_acc, std::span<const int16_t, L1_SIZE> ntm_acc, int bucket,
+                  std::span<uint8_t, L1_SIZE> ft_outputs) {
+    alignas(64) int32_t l1_outputs[ACTUAL_L2_SIZE];
+    alignas(64) int32_t l2_outputs[L3_SIZE];
+    int32_t l3_output;
+    SparseIterator si;
+
+    activate_ft(stm_acc, ntm_acc, ft_outputs, si);
+    propagate_l1(bucket, ft_outputs, l1_outputs, si);
+    propagate_l2(bucket, l1_outputs, l2_outputs);
+    propagate_l3(bucket, l2_outputs, l3_output);
+
+    return l3_output;
+}
+
+/// activate_ft without collecting the non-zero chunks, for the dense L1 of batches
+static void activate_ft_dense(std::span<const int16_t, L1_SIZE> stm_acc, std::span<const int16_t, L1_SIZE> ntm_acc,
+                              std::span<uint8_t, L1_SIZE> outputs) {
+    const auto pov_activate = [&](std::span<const int16_t, L1_SIZE> acc, int output_offset) {
+#if USE_SIMD
+        using namespace simd;
+
+        vepi16 zero = zero_i16();
+        vepi16 one = set_i16(QA);
+
+        for (size_t idx = 0; idx < PAIR_COUNT; idx += 4 * CHUNK_SIZE_16BIT) {
+            vepi16 i0_left = clamp_i16(load_i16(&acc[idx + CHUNK_SIZE_16BIT * 0]), zero, one);
+            vepi16 i1_left = clamp_i16(load_i16(&acc[idx + CHUNK_SIZE_16BIT * 1]), zero, one);
+            vepi16 i2_left = clamp_i16(load_i16(&acc[idx + CHUNK_SIZE_16BIT * 2]), zero, one);
+            vepi16 i3_left = clamp_i16(load_i16(&acc[idx + CHUNK_SIZE_16BIT * 3]), zero, one);
+
+            vepi16 i0_right = clamp_i16(load_i16(&acc[idx + PAIR_COUNT + CHUNK_SIZE_16BIT * 0]), zero, one);
+            vepi16 i1_right = clamp_i16(load_i16(&acc[idx + PAIR_COUNT + CHUNK_SIZE_16BIT * 1]), zero, one);
+            vepi16 i2_right = clamp_i16(load_i16(&acc[idx + PAIR_COUNT + CHUNK_SIZE_16BIT * 2]), zero, one);
+            vepi16 i3_right = clamp_i16(load_i16(&acc[idx + PAIR_COUNT + CHUNK_SIZE_16BIT * 3]), zero, one);
+
+            vepi16 pw0 = mulhi_i16(shiftleft_i16(i0_left, FT_SCALE_BITS), i0_right);
+            vepi16 pw1 = mulhi_i16(shiftleft_i16(i1_left, FT_SCALE_BITS), i1_right);
+            vepi16 pw2 = mulhi_i16(shiftleft_i16(i2_left, FT_SCALE_BITS), i2_right);
+            vepi16 pw3 = mulhi_i16(shiftleft_i16(i3_left, FT_SCALE_BITS), i3_right);
+
+            vepu8 packed0 = packus_i16(pw0, pw1);
+            vepu8 packed1 = packus_i16(pw2, pw3);
+
+            store_u8(&outputs[output_offset + idx + CHUNK_SIZE_8BIT * 0], packed0);
+            store_u8(&outputs[output_offset + idx + CHUNK_SIZE_8BIT * 1], packed1);
+        }
+
+#else
+        for (int i = 0; i < PAIR_COUNT; ++i) {
+            int32_t i0_left = std::clamp<int16_t>(acc[i], 0, QA);
+            int32_t i0_right = std::clamp<int16_t>(acc[i + PAIR_COUNT], 0, QA);
+
+            // simulate mulhi
+            outputs[i + output_offset] = ((i0_left << FT_SCALE_BITS) * i0_right) >> 16;
+        }
+#endif
+    };
+
+    pov_activate(stm_acc, 0);
+    pov_activate(ntm_acc, PAIR_COUNT);
+}
+
+void activate_ft(std::span<const int16_t, L1_SIZE> stm_acc, std::span<const int16_t, L1_SIZE> ntm_acc,
+                 std::span<uint8_t, L1_SIZE> outputs, [[maybe_unused]] SparseIterator &si) {
+    activate_ft_dense(stm_acc, ntm_acc, outputs);
+
+#if USE_SIMD
+    using namespace simd;
+    for (size_t out = 0; out < L1_SIZE; out += CHUNK_SIZE_8BIT * 2) {
+        const vepu8 a = load_u8(&outputs[out + CHUNK_SIZE_8BIT * 0]);
+        const vepu8 b = load_u8(&outputs[out + CHUNK_SIZE_8BIT * 1]);
+        si.update(a, b);
+    }
+#endif // USE_SIMD
+}
+
+constexpr int L1_SHIFT = 8;
+
+#if USE_SIMD
+/// Applies shift and SCReLU activation to the L1 sums of outputs [offset, offset + CHUNK_SIZE_32BIT) and stores them
+static inline void activate_l1(simd::vepi32 sums, std::span<int32_t, ACTUAL_L2_SIZE> outputs, size_t offset) {
+    using namespace simd;
+
+    const vepi32 zero = zero_i32();
+    const vepi32 one = set_i32(QC);
+    const vepi32 one_sq = set_i32(QC * QC);
+    const vepi32 x = shiftright_i32(sums, L1_SHIFT);
+
+    if constexpr (DUAL_ACTIVATION) {
+        vepi32 out0 = clamp_i32(x, zero, one);
+        out0 = shiftleft_i32(out0, QC_BITS); // upscale to QC^2 space
+
+        vepi32 out1 = mullo_i32(x, x);
+        out1 = clamp_i32(out1, zero, one_sq);
+
+        store_i32(&outputs[offset], out0);
+        store_i32(&outputs[offset + L2_SIZE], out1);
+    } else {
+        vepi32 out = clamp_i32(x, zero, one);
+        out = mullo_i32(out, out);
+
+        store_i32(&outputs[offset], out);
+    }
+}
+#endif // USE_SIMD
+
+void propagate_l1(int bucket, std::span<const uint8_t, L1_SIZE> inputs, std::span<int32_t, ACTUAL_L2_SIZE> outputs,
+                  [[maybe_unused]] const SparseIterator &si) {
+
+#if USE_SIMD
+    using namespace simd;
+
+    const int32_t *packed_input = reinterpret_cast<const int32_t *>(inputs.data());
+    const size_t nnz = si.count();
+    const size_t nnz_quad_chunk = (nnz / 4) * 4;
+
+    // Number of registers needed for L2 propagation
+    constexpr size_t NUM_REGISTERS = L2_SIZE / CHUNK_SIZE_32BIT;
+    vepi32 l2_regs[NUM_REGISTERS][4];
+
+    // Init registers with L2 biases
+    for (size_t i = 0; i < NUM_REGISTERS; ++i) {
+        l2_regs[i][0] = load_i32(&network->l1_biases[bucket][i * CHUNK_SIZE_32BIT]);
+        l2_regs[i][1] = zero_i32();
+        l2_regs[i][2] = zero_i32();
+        l2_regs[i][3] = zero_i32();
+    }
+
+    // Accumulate dot products
+    for (size_t nnz_id = 0; nnz_id < nnz_quad_chunk; nnz_id += 4) {
+        const size_t idx0 = si.chunk(nnz_id + 0);
+        const size_t idx1 = si.chunk(nnz_id + 1);
+        const size_t idx2 = si.chunk(nnz_id + 2);
+        const size_t idx3 = si.chunk(nnz_id + 3);
+
+        const vepi32 in0 = set_i32(packed_input[idx0]);
+        const vepi32 in1 = set_i32(packed_input[idx1]);
+        const vepi32 in2 = set_i32(packed_input[idx2]);
+        const vepi32 in3 = set_i32(packed_input[idx3]);
+
+        for (size_t out_idx = 0; out_idx < L2_SIZE; out_idx += CHUNK_SIZE_32BIT) {
+            auto &reg = l2_regs[out_idx / CHUNK_SIZE_32BIT];
+
+            const vepi8 w0 = load_i8(&network->l1_weights[bucket][idx0][out_idx][0]);
+            const vepi8 w1 = load_i8(&network->l1_weights[bucket][idx1][out_idx][0]);
+            const vepi8 w2 = load_i8(&network->l1_weights[bucket][idx2][out_idx][0]);
+            const vepi8 w3 = load_i8(&network->l1_weights[bucket][idx3][out_idx][0]);
+
+            reg[0] = dpbusd_i32(reg[0], in0, w0);
+            reg[1] = dpbusd_i32(reg[1], in1, w1);
+            reg[2] = dpbusd_i32(reg[2], in2, w2);
+            reg[3] = dpbusd_i32(reg[3], in3, w3);
+        }
+    }
+
+    for (size_t chunk = nnz_quad_chunk; chunk < nnz; ++chunk) {
+        const uint16_t idx = si.chunk(chunk);
+        const vepi32 input = set_i32(packed_input[idx]);
+
+        for (size_t out_idx = 0; out_idx < L2_SIZE; out_idx += CHUNK_SIZE_32BIT) {
+            auto &reg = l2_regs[out_idx / CHUNK_SIZE_32BIT];
+            const vepi8 w = load_i8(&network->l1_weights[bucket][idx][out_idx][0]);
+
+            reg[0] = dpbusd_i32(reg[0], input, w);
+        }
+    }
+
+    for (size_t i = 0; i < NUM_REGISTERS; ++i) {
+        vepi32 tmp0 = add_i32(l2_regs[i][0], l2_regs[i][1]);
+        vepi32 tmp1 = add_i32(l2_regs[i][2], l2_regs[i][3]);
+        activate_l1(add_i32(tmp0, tmp1), outputs, i * CHUNK_SIZE_32BIT);
+    }
+#else
+    // Initialize accumulators with biases
+    for (size_t output_idx = 0; output_idx < L2_SIZE; ++output_idx) {
+        outputs[output_idx] = network->l1_biases[bucket][output_idx];
+    }
+
+    // Accumulate dot products, simulating dpbusd_i32
+    for (size_t chunk = 0; chunk < L1_SIZE / 4; ++chunk) {
+        const int32_t in0 = inputs[chunk * 4 + 0];
+        const int32_t in1 = inputs[chunk * 4 + 1];
+        const int32_t in2 = inputs[chunk * 4 + 2];
+        const int32_t in3 = inputs[chunk * 4 + 3];
+
+        for (size_t output_idx = 0; output_idx < L2_SIZE; ++output_idx) {
+            const int32_t w0 = network->l1_weights[bucket][chunk][output_idx][0];
+            const int32_t w1 = network->l1_weights[bucket][chunk][output_idx][1];
+            const int32_t w2 = network->l1_weights[bucket][chunk][output_idx][2];
+            const int32_t w3 = network->l1_weights[bucket][chunk][output_idx][3];
+
+            outputs[output_idx] += (in0 * w0) + (in1 * w1) + (in2 * w2) + (in3 * w3);
+        }
+    }
+
+    // Apply shift, SCReLU activation and store
+    for (size_t output_idx = 0; output_idx < L2_SIZE; ++output_idx) {
+        int32_t x = outputs[output_idx] >> L1_SHIFT;
+        if constexpr (DUAL_ACTIVATION) {
+            int32_t crelu = std::clamp(x, 0, QC);
+            outputs[output_idx] = crelu << QC_BITS; // upscale to QC^2 space
+
+            // CSReLU
+            // Cast via uint32_t to simulate the truncation of mullo
+            int32_t sq = static_cast<int32_t>(static_cast<uint32_t>(x) * static_cast<uint32_t>(x));
+            outputs[output_idx + L2_SIZE] = std::clamp(sq, 0, QC * QC);
+        } else {
+            x = std::clamp(x, 0, QC);
+            outputs[output_idx] = x * x;
+        }
+    }
+#endif
+}
+
+/// Does not activate outputs, that's done on 'propagate_l3'
+void propagate_l2(int bucket, std::span<const int32_t, ACTUAL_L2_SIZE> inputs, std::span<int32_t, L3_SIZE> outputs) {
+    // L2 biases
+    std::memcpy(outputs.data(), &network->l2_biases[bucket], outputs.size_bytes());
+
+    // L2 matmul
+#if USE_SIMD
+    using namespace simd;
+
+    for (size_t input_idx = 0; input_idx < ACTUAL_L2_SIZE; ++input_idx) {
+        vepi32 input = set_i32(inputs[input_idx]);
+
+        for (size_t output_idx = 0; output_idx < L3_SIZE; output_idx += CHUNK_SIZE_32BIT) {
+            vepi32 weights = load_i32(&network->l2_weights[bucket][input_idx][output_idx]);
+            vepi32 output = load_i32(&outputs[output_idx]);
+
+            vepi32 product = mullo_i32(input, weights);
+            output = add_i32(output, product);
+
+            store_i32(&outputs[output_idx], output);
+        }
+    }
+#else
+    for (size_t input_idx = 0; input_idx < ACTUAL_L2_SIZE; ++input_idx) {
+        const int32_t input = inputs[input_idx];
+        const int32_t *weights = &network->l2_weights[bucket][input_idx][0];
+        for (size_t output_idx = 0; output_idx < L3_SIZE; ++output_idx) {
+            outputs[output_idx] += weights[output_idx] * input;
+        }
+    }
+#endif
+}
+
+void propagate_l3(int bucket, std::span<const int32_t, L3_SIZE> inputs, int32_t &output) {
+    // Activate L2 outputs ('inputs') and L3 matmul
+#if USE_SIMD
+    using namespace simd;
+
+    const vepi32 zero = zero_i32();
+    const vepi32 one = set_i32(QC * QC * QC);
+
+    vepi32 output_vec = zero;
+    for (size_t idx = 0; idx < L3_SIZE; idx += CHUNK_SIZE_32BIT) {
+        vepi32 input = load_i32(&inputs[idx]);
+        vepi32 weights = load_i32(&network->l3_weights[bucket][idx]);
+
+        input = clamp_i32(input, zero, one); // Activate L2 outputs
+        output_vec = add_i32(output_vec, mullo_i32(input, weights));
+    }
+
+    output = hsum_i32(output_vec);
+#else
+    output = 0;
+    for (size_t idx = 0; idx < L3_SIZE; ++idx) {
+        const int32_t l2_out = std::clamp(inputs[idx], 0, QC * QC * QC); // Activate L2 output
+        output += l2_out * network->l3_weights[bucket][idx];
+    }
+#endif
+
+    // Add L3 bias
+    output += network->l3_biases[bucket];
+
+    int64_t rescaled_out = static_cast<int64_t>(output);
+    rescaled_out *= SCALE;
+    rescaled_out /= QC * QC * QC * QC;
+
+    output = static_cast<int32_t>(rescaled_out);
+}
+
+#if USE_SIMD
+// As many positions as fit in about half the registers, with the L1 sums of each taking one or more
+constexpr size_t BATCH_SIZE = std::max<size_t>(8 / (L2_SIZE / simd::CHUNK_SIZE_32BIT), 1);
+
+/// L1 of BATCH_SIZE positions of the same bucket, as a matrix product. Dense, since most chunks are non-zero anyway
+/// and every weight register loaded is then used for the whole batch
+static void propagate_l1_batch(int bucket, const uint8_t (&inputs)[BATCH_SIZE][L1_SIZE],
+                               int32_t (&outputs)[BATCH_SIZE][ACTUAL_L2_SIZE]) {
+    using namespace simd;
+
+    constexpr size_t NUM_REGISTERS = L2_SIZE / CHUNK_SIZE_32BIT;
+    vepi32 sums[BATCH_SIZE][NUM_REGISTERS];
+    for (size_t batch_idx = 0; batch_idx < BATCH_SIZE; ++batch_idx) {
+        for (size_t i = 0; i < NUM_REGISTERS; ++i)
+            sums[batch_idx][i] = load_i32(&network->l1_biases[bucket][i * CHUNK_SIZE_32BIT]);
+    }
+
+    for (size_t chunk = 0; chunk < L1_SIZE / 4; ++chunk) {
+        vepi8 weights[NUM_REGISTERS];
+        for (size_t i = 0; i < NUM_REGISTERS; ++i)
+            weights[i] = load_i8(&network->l1_weights[bucket][chunk][i * CHUNK_SIZE_32BIT][0]);
+
+        for (size_t batch_idx = 0; batch_idx < BATCH_SIZE; ++batch_idx) {
+            const vepi32 input = set_i32(reinterpret_cast<const int32_t *>(inputs[batch_idx])[chunk]);
+            for (size_t i = 0; i < NUM_REGISTERS; ++i)
+                sums[batch_idx][i] = dpbusd_i32(sums[batch_idx][i], input, weights[i]);
+        }
+    }
+
+    for (size_t batch_idx = 0; batch_idx < BATCH_SIZE; ++batch_idx) {
+        for (size_t i = 0; i < NUM_REGISTERS; ++i)
+            activate_l1(sums[batch_idx][i], outputs[batch_idx], i * CHUNK_SIZE_32BIT);
+    }
+}
+
+/// L2 of BATCH_SIZE positions of the same bucket, as a matrix product
+static void propagate_l2_batch(int bucket, const int32_t (&inputs)[BATCH_SIZE][ACTUAL_L2_SIZE],
+                               int32_t (&outputs)[BATCH_SIZE][L3_SIZE]) {
+    using namespace simd;
+
+    constexpr size_t NUM_REGISTERS = L3_SIZE / CHUNK_SIZE_32BIT;
+    vepi32 sums[BATCH_SIZE][NUM_REGISTERS];
+    for (size_t batch_idx = 0; batch_idx < BATCH_SIZE; ++batch_idx) {
+        for (size_t i = 0; i < NUM_REGISTERS; ++i)
+            sums[batch_idx][i] = load_i32(&network->l2_biases[bucket][i * CHUNK_SIZE_32BIT]);
+    }
+
+    for (size_t input_idx = 0; input_idx < ACTUAL_L2_SIZE; ++input_idx) {
+        vepi32 weights[NUM_REGISTERS];
+        for (size_t i = 0; i < NUM_REGISTERS; ++i)
+            weights[i] = load_i32(&network->l2_weights[bucket][input_idx][i * CHUNK_SIZE_32BIT]);
+
+        for (size_t batch_idx = 0; batch_idx < BATCH_SIZE; ++batch_idx) {
+            const vepi32 input = set_i32(inputs[batch_idx][input_idx]);
+            for (size_t i = 0; i < NUM_REGISTERS; ++i)
+                sums[batch_idx][i] = add_i32(sums[batch_idx][i], mullo_i32(input, weights[i]));
+        }
+    }
+
+    for (size_t batch_idx = 0; batch_idx < BATCH_SIZE; ++batch_idx) {
+        for (size_t i = 0; i < NUM_REGISTERS; ++i)
+            store_i32(&outputs[batch_idx][i * CHUNK_SIZE_32BIT], sums[batch_idx][i]);
+    }
+}
+#endif // USE_SIMD
+
+void propagate_batch(std::span<const Input> inputs, std::span<int32_t> outputs) {
+    assert(outputs.size() >= inputs.size());
+
+    alignas(64) uint8_t ft_buffer[L1_SIZE];
+    const auto propagate_one = [&](size_t idx) {
+        outputs[idx] = propagate(inputs[idx].stm_acc, inputs[idx].ntm_acc, inputs[idx].bucket, ft_buffer);
+    };
+
+#if USE_SIMD
+    const auto propagate_group = [&](int bucket, const size_t (&group)[BATCH_SIZE]) {
+        alignas(64) uint8_t ft_outputs[BATCH_SIZE][L1_SIZE];
+        alignas(64) int32_t l1_outputs[BATCH_SIZE][ACTUAL_L2_SIZE];
+        alignas(64) int32_t l2_outputs[BATCH_SIZE][L3_SIZE];
+
+        for (size_t batch_idx = 0; batch_idx < BATCH_SIZE; ++batch_idx) {
+            const Input &input = inputs[group[batch_idx]];
+            activate_ft_dense(input.stm_acc, input.ntm_acc, ft_outputs[batch_idx]);
+        }
+        propagate_l1_batch(bucket, ft_outputs, l1_outputs);
+        propagate_l2_batch(bucket, l1_outputs, l2_outputs);
+        for (size_t batch_idx = 0; batch_idx < BATCH_SIZE; ++batch_idx)
+            propagate_l3(bucket, l2_outputs[batch_idx], outputs[group[batch_idx]]);
+    };
+
+    for (int bucket = 0; bucket < OUTPUT_BUCKET_COUNT; ++bucket) {
+        size_t group[BATCH_SIZE];
+        size_t group_size = 0;
+        for (size_t idx = 0; idx < inputs.size(); ++idx) {
+            if (inputs[idx].bucket != bucket)
+                continue;
+
+            group[group_size++] = idx;
+            if (group_size == BATCH_SIZE) {
+                propagate_group(bucket, group);
+                group_size = 0;
+            }
+        }
+
+        for (size_t group_idx = 0; group_idx < group_size; ++group_idx)
+            propagate_one(group[group_idx]);
+    }
+#else
+    for (size_t idx = 0; idx < inputs.size(); ++idx)
+        propagate_one(idx);
+#endif
+}
+
+void bench(std::span<const Input> inputs, LayerCycles &cycles) {
+    for (const Input &input : inputs) {
+        alignas(64) uint8_t ft_outputs[L1_SIZE];
+        alignas(64) int32_t l1_outputs[ACTUAL_L2_SIZE];
+        alignas(64) int32_t l2_outputs[L3_SIZE];
+        int32_t l3_output;
+        SparseIterator si;
+
+        const uint64_t start = cycle_count();
+        activate_ft(input.stm_acc, input.ntm_acc, ft_outputs, si);
+        const uint64_t ft_done = cycle_count();
+        propagate_l1(input.bucket, ft_outputs, l1_outputs, si);
+        const uint64_t l1_done = cycle_count();
+        propagate_l2(input.bucket, l1_outputs, l2_outputs);
+        const uint64_t l2_done = cycle_count();
+        propagate_l3(input.bucket, l2_outputs, l3_output);
+        const uint64_t l3_done = cycle_count();
+
+        ++cycles.calls[input.bucket];
+        cycles.activate_ft[input.bucket] += ft_done - start;
+        cycles.propagate_l1[input.bucket] += l1_done - ft_done;
+        cycles.propagate_l2[input.bucket] += l2_done - l1_done;
+        cycles.propagate_l3[input.bucket] += l3_done - l2_done;
+        cycles.checksum += l3_output;
+
+        // Counted here rather than from the SparseIterator, which scalar builds don't fill
+        size_t nnz = 0;
+        for (size_t chunk = 0; chunk < L1_SIZE; chunk += 4)
+            nnz += (ft_outputs[chunk] | ft_outputs[chunk + 1] | ft_outputs[chunk + 2] | ft_outputs[chunk + 3]) != 0;
+        ++cycles.nnz_histogram[nnz];
+    }
+}
+
+#if USE_SIMD
+const Kernels kernels = {propagate, propagate_batch, bench, simd::PACKUS_LANE_COUNT, simd::PACKUS_LANE_ORDER};
+#else
+static constexpr size_t UNPERMUTED_LANE_ORDER[1] = {0};
+const Kernels kernels = {propagate, propagate_batch, bench, 1, UNPERMUTED_LANE_ORDER};
+#endif
+
+} // namespace SIMD_ISA
+} // namespace Forward
@@ -0,0 +1,82 @@
+/*
+ *  Minke is a UCI chess engine
+ *  Copyright (C) 2026 Eduardo Marinho <eduardomarinho@pm.me>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+#include "eval/nnue/arch.h"
+#include "eval/nnue/sparse_iterator.h"
+
+namespace Forward {
+
+/// Both accumulators of a position, ordered by side to move, and its output bucket
+struct Input {
+    std::span<const int16_t, L1_SIZE> stm_acc;
+    std::span<const int16_t, L1_SIZE> ntm_acc;
+    int bucket;
+};
+
+/// Cycles spent in every layer by bench(), summed per output bucket
+struct LayerCycles {
+    std::array<uint64_t, OUTPUT_BUCKET_COUNT> calls{};
+    std::array<uint64_t, OUTPUT_BUCKET_COUNT> activate_ft{};
+    std::array<uint64_t, OUTPUT_BUCKET_COUNT> propagate_l1{};
+    std::array<uint64_t, OUTPUT_BUCKET_COUNT> propagate_l2{};
+    std::array<uint64_t, OUTPUT_BUCKET_COUNT> propagate_l3{};
+    std::array<uint64_t, L1_SIZE / 4 + 1> nnz_histogram{}; // calls by number of non-zero 4-byte chunks of L1 input
+    int64_t checksum = 0;                                   // keeps the compiler from dropping the passes
+};
+
+/// One build of the forward pass, together with the feature transformer layout its packus expects
+struct Kernels {
+    int32_t (*propagate)(std::span<const int16_t, L1_SIZE> stm_acc, std::span<const int16_t, L1_SIZE> ntm_acc,
+                         int bucket, std::span<uint8_t, L1_SIZE> ft_outputs);
+    void (*propagate_batch)(std::span<const Input> inputs, std::span<int32_t> outputs);
+    void (*bench)(std::span<const Input> inputs, LayerCycles &cycles);
+    size_t packus_lane_count;
+    const size_t *packus_lane_order;
+};
+
+inline namespace SIMD_ISA {
+
+/// Runs every layer from both accumulators, leaving the activated feature transformer outputs in 'ft_outputs'
+int32_t propagate(std::span<const int16_t, L1_SIZE> stm_acc, std::span<const int16_t, L1_SIZE> ntm_acc, int bucket,
+                  std::span<uint8_t, L1_SIZE> ft_outputs);
+
+/// Same as propagate for many independent positions, writing the output of inputs[i] to outputs[i]. Positions that
+/// share an output bucket go through L1 and L2 together, sharing every weight load
+void propagate_batch(std::span<const Input> inputs, std::span<int32_t> outputs);
+
+void activate_ft(std::span<const int16_t, L1_SIZE> stm_acc, std::span<const int16_t, L1_SIZE> ntm_acc,
+                 std::span<uint8_t, L1_SIZE> outputs, SparseIterator &si);
+void propagate_l1(int bucket, std::span<const uint8_t, L1_SIZE> inputs, std::span<int32_t, ACTUAL_L2_SIZE> outputs,
+                  const SparseIterator &si);
+void propagate_l2(int bucket, std::span<const int32_t, ACTUAL_L2_SIZE> inputs, std::span<int32_t, L3_SIZE> outputs);
+void propagate_l3(int bucket, std::span<const int32_t, L3_SIZE> inputs, int32_t &output);
+
+/// Runs every input through the layers one at a time, timing each of them separately
+void bench(std::span<const Input> inputs, LayerCycles &cycles);
+
+extern const Kernels kernels;
+
+} // namespace SIMD_ISA
+} // namespace Forward
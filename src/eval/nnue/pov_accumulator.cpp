@@ -18,11 +18,13 @@
 
 #include "eval/nnue/pov_accumulator.h"
 
+#include <array>
 #include <cstddef>
-#include <cstring>
 
 #include "core/position.h"
 #include "eval/nnue/arch.h"
+#include "eval/nnue/dispatch.h"
+#include "eval/nnue/update.h"
 
 PovAccumulator::PovAccumulator(const Position &pos, const Color pov) {
     // Debug-only constructor. Computes a PovAccumulator from scratch and uses it as a
@@ -36,39 +38,72 @@ PovAccumulator::PovAccumulator(const Position &pos, const Color pov) {
     }
 }
 
+/// The update kernels of the instruction set in use
+static inline const Update::Kernels &update_kernels() {
+#if USE_DISPATCH
+    return Dispatch::update_kernels();
+#else
+    return Update::kernels;
+#endif
+}
+
+/// Runs the kernel for POV_COUNT perspectives with ADD_COUNT added and SUB_COUNT removed features, which are indexed
+/// by [feature * POV_COUNT + pov]
+template <size_t POV_COUNT, size_t ADD_COUNT, size_t SUB_COUNT>
+static inline void update(const std::array<int16_t *, POV_COUNT> &outputs,
+                          const std::array<const int16_t *, POV_COUNT> &inputs,
+                          const std::array<size_t, ADD_COUNT * POV_COUNT> &adds,
+                          const std::array<size_t, SUB_COUNT * POV_COUNT> &subs) {
+    update_kernels().update[POV_COUNT - 1][ADD_COUNT][SUB_COUNT](outputs.data(), inputs.data(), adds.data(),
+                                                                  subs.data());
+}
+
 void PovAccumulator::add(const PovAccumulator &input, const size_t add0) {
-    for (int column{0}; column < L1_SIZE; ++column) {
-        m_neurons[column] = input.m_neurons[column] + network.ft_weights[add0 + column];
-    }
+    update<1, 1, 0>({m_neurons.data()}, {input.m_neurons.data()}, {add0}, {});
 }
 
 void PovAccumulator::sub(const PovAccumulator &input, const size_t sub0) {
-    for (int column{0}; column < L1_SIZE; ++column) {
-        m_neurons[column] = input.m_neurons[column] - network.ft_weights[sub0 + column];
-    }
+    update<1, 0, 1>({m_neurons.data()}, {input.m_neurons.data()}, {}, {sub0});
 }
 
 void PovAccumulator::add_sub(const PovAccumulator &input, const size_t add0, const size_t sub0) {
-    for (int column{0}; column < L1_SIZE; ++column) {
-        m_neurons[column] =
-            input.m_neurons[column] + network.ft_weights[add0 + column] - network.ft_weights[sub0 + column];
-    }
+    update<1, 1, 1>({m_neurons.data()}, {input.m_neurons.data()}, {add0}, {sub0});
 }
 
 void PovAccumulator::add_sub2(const PovAccumulator &input, const size_t add0, const size_t sub0, const size_t sub1) {
-    for (int column{0}; column < L1_SIZE; ++column) {
-        m_neurons[column] = input.m_neurons[column] + network.ft_weights[add0 + column] -
-                            network.ft_weights[sub0 + column] - network.ft_weights[sub1 + column];
-    }
+    update<1, 1, 2>({m_neurons.data()}, {input.m_neurons.data()}, {add0}, {sub0, sub1});
 }
 
 void PovAccumulator::add2_sub2(const PovAccumulator &input, const size_t add0, const size_t add1, const size_t sub0,
                                const size_t sub1) {
-    for (int column{0}; column < L1_SIZE; ++column) {
-        m_neurons[column] = input.m_neurons[column] + network.ft_weights[add0 + column] +
-                            network.ft_weights[add1 + column] - network.ft_weights[sub0 + column] -
-                            network.ft_weights[sub1 + column];
-    }
+    update<1, 2, 2>({m_neurons.data()}, {input.m_neurons.data()}, {add0, add1}, {sub0, sub1});
+}
+
+void PovAccumulator::add_sub_dual(PovAccumulator (&outputs)[2], const PovAccumulator (&inputs)[2],
+                                  const size_t (&add0)[2], const size_t (&sub0)[2]) {
+    update<2, 1, 1>({outputs[WHITE].m_neurons.data(), outputs[BLACK].m_neurons.data()},
+                    {inputs[WHITE].m_neurons.data(), inputs[BLACK].m_neurons.data()}, {add0[WHITE], add0[BLACK]},
+                    {sub0[WHITE], sub0[BLACK]});
+}
+
+void PovAccumulator::add_sub2_dual(PovAccumulator (&outputs)[2], const PovAccumulator (&inputs)[2],
+                                   const size_t (&add0)[2], const size_t (&sub0)[2], const size_t (&sub1)[2]) {
+    update<2, 1, 2>({outputs[WHITE].m_neurons.data(), outputs[BLACK].m_neurons.data()},
+                    {inputs[WHITE].m_neurons.data(), inputs[BLACK].m_neurons.data()}, {add0[WHITE], add0[BLACK]},
+                    {sub0[WHITE], sub0[BLACK], sub1[WHITE], sub1[BLACK]});
+}
+
+void PovAccumulator::add2_sub2_dual(PovAccumulator (&outputs)[2], const PovAccumulator (&inputs)[2],
+                                    const size_t (&add0)[2], const size_t (&add1)[2], const size_t (&sub0)[2],
+                                    const size_t (&sub1)[2]) {
+    update<2, 2, 2>({outputs[WHITE].m_neurons.data(), outputs[BLACK].m_neurons.data()},
+                    {inputs[WHITE].m_neurons.data(), inputs[BLACK].m_neurons.data()},
+                    {add0[WHITE], add0[BLACK], add1[WHITE], add1[BLACK]},
+                    {sub0[WHITE], sub0[BLACK], sub1[WHITE], sub1[BLACK]});
+}
+
+void PovAccumulator::apply(const PovAccumulator &input, std::span<const size_t> adds, std::span<const size_t> subs) {
+    update_kernels().apply(m_neurons.data(), input.m_neurons.data(), adds, subs);
 }
 
 void PovAccumulator::self_add(const size_t add0) { add(*this, add0); }
@@ -36,7 +36,7 @@ class alignas(64) PovAccumulator {
 
     PovAccumulator &operator=(const PovAccumulator &) = default;
 
-    inline void reset() { std::memcpy(m_neurons.data(), network.ft_biases, sizeof(network.ft_biases)); }
+    inline void reset() { std::memcpy(m_neurons.data(), network->ft_biases, sizeof(network->ft_biases)); }
 
     std::span<const int16_t, L1_SIZE> neurons() const { return m_neurons; }
 
@@ -46,6 +46,17 @@ class alignas(64) PovAccumulator {
     void add_sub2(const PovAccumulator &input, const size_t add0, const size_t sub0, const size_t sub1);
     void add2_sub2(const PovAccumulator &input, const size_t add0, const size_t add1, const size_t sub0,
                    const size_t sub1);
+    // Same as the updates above for both perspectives at once, in a single loop over the columns. Indexed by color
+    static void add_sub_dual(PovAccumulator (&outputs)[2], const PovAccumulator (&inputs)[2], const size_t (&add0)[2],
+                             const size_t (&sub0)[2]);
+    static void add_sub2_dual(PovAccumulator (&outputs)[2], const PovAccumulator (&inputs)[2], const size_t (&add0)[2],
+                              const size_t (&sub0)[2], const size_t (&sub1)[2]);
+    static void add2_sub2_dual(PovAccumulator (&outputs)[2], const PovAccumulator (&inputs)[2],
+                               const size_t (&add0)[2], const size_t (&add1)[2], const size_t (&sub0)[2],
+                               const size_t (&sub1)[2]);
+
+    /// Applies any number of feature changes in a single pass, each column is loaded and stored only once
+    void apply(const PovAccumulator &input, std::span<const size_t> adds, std::span<const size_t> subs);
 
     void self_add(const size_t add0);
     void self_sub(const size_t sub0);
@@ -18,6 +18,16 @@
 
 #pragma once
 
+// Dispatch builds link the inference kernels once per instruction set, so everything that depends on it lives in an
+// inline namespace named after the instruction set, keeping the linker from merging two versions of the same function
+#ifndef SIMD_ISA
+#if USE_DISPATCH
+#define SIMD_ISA scalar
+#else
+#define SIMD_ISA native
+#endif
+#endif
+
 #include "eval/nnue/simd/avx2.h"
 #include "eval/nnue/simd/avx512.h"
 #include "eval/nnue/simd/neon.h"
@@ -26,6 +26,7 @@
 #include <cstdint>
 
 namespace simd {
+inline namespace SIMD_ISA {
 
 constexpr size_t PACKUS_LANE_COUNT = 4;
 constexpr size_t PACKUS_LANE_ORDER[4] = {0, 2, 1, 3};
@@ -78,6 +79,11 @@ inline vepi16 set_i16(const int16_t v) { return _mm256_set1_epi16(v); }
 
 inline vepi16 load_i16(const void* ptr) { return _mm256_load_si256(static_cast<const vepi16*>(ptr)); }
 
+// Loads CHUNK_SIZE_16BIT int8, sign extended
+inline vepi16 load_widen_i8(const void* ptr) {
+    return _mm256_cvtepi8_epi16(_mm_load_si128(static_cast<const __m128i*>(ptr)));
+}
+
 inline void store_i16(void* ptr, vepi16 v) { _mm256_store_si256(static_cast<vepi16*>(ptr), v); }
 
 inline vepi16 min_i16(const vepi16 v, const vepi16 min) { return _mm256_min_epi16(v, min); }
@@ -142,11 +148,16 @@ inline int32_t hsum_i32(const vepi32 vec) {
 }
 
 inline vepi32 dpbusd_i32(vepi32 sum, vepu8 u, vepi8 i) {
+#if USE_AVXVNNI
+    return _mm256_dpbusd_avx_epi32(sum, u, i);
+#else
     const vepi16 p = _mm256_maddubs_epi16(u, i);
     const vepi32 w = madd_i16(p, set_i16(1));
     return add_i32(sum, w);
+#endif
 }
 
+} // namespace SIMD_ISA
 } // namespace simd
 
 #endif
@@ -26,9 +26,16 @@
 #include <cstdint>
 
 namespace simd {
+inline namespace SIMD_ISA {
 
+#if USE_DISPATCH
+// Dispatch builds share one net between all kernels, laid out for the avx2 packus, whose order packus_i16 restores
+constexpr size_t PACKUS_LANE_COUNT = 4;
+constexpr size_t PACKUS_LANE_ORDER[4] = {0, 2, 1, 3};
+#else
 constexpr size_t PACKUS_LANE_COUNT = 8;
 constexpr size_t PACKUS_LANE_ORDER[8] = {0, 2, 4, 6, 1, 3, 5, 7};
+#endif
 
 using vepu8 = __m512i;
 using vepu16 = __m512i;
@@ -76,6 +83,11 @@ inline vepi16 set_i16(const int16_t v) { return _mm512_set1_epi16(v); }
 
 inline vepi16 load_i16(const void* ptr) { return _mm512_load_si512(static_cast<const vepi16*>(ptr)); }
 
+// Loads CHUNK_SIZE_16BIT int8, sign extended
+inline vepi16 load_widen_i8(const void* ptr) {
+    return _mm512_cvtepi8_epi16(_mm256_load_si256(static_cast<const __m256i*>(ptr)));
+}
+
 inline void store_i16(void* ptr, vepi16 v) { _mm512_store_si512(static_cast<vepi16*>(ptr), v); }
 
 inline vepi16 min_i16(const vepi16 v, const vepi16 min) { return _mm512_min_epi16(v, min); }
@@ -98,7 +110,14 @@ inline vepi16 shiftleft_i16(const vepi16 a, const int c) { return _mm512_slli_ep
 
 inline vepi16 shiftright_i16(const vepi16 a, const int c) { return _mm512_srai_epi16(a, c); }
 
-inline vepu8 packus_i16(const vepi16 a, const vepi16 b) { return _mm512_packus_epi16(a, b); }
+inline vepu8 packus_i16(const vepi16 a, const vepi16 b) {
+#if USE_DISPATCH
+    // With the avx2 layout the packed 64-bit lanes hold the groups of 8 columns 0, 4, 2, 6, 1, 5, 3, 7 of every 64
+    return _mm512_permutexvar_epi64(_mm512_setr_epi64(0, 4, 2, 6, 1, 5, 3, 7), _mm512_packus_epi16(a, b));
+#else
+    return _mm512_packus_epi16(a, b);
+#endif
+}
 
 /// i32
 
@@ -129,11 +148,16 @@ inline vepi32 shiftright_i32(const vepi32 a, const int c) { return _mm512_srai_e
 inline int32_t hsum_i32(const vepi32 v) { return _mm512_reduce_add_epi32(v); }
 
 inline vepi32 dpbusd_i32(vepi32 sum, vepu8 u, vepi8 i) {
+#if USE_VNNI512
+    return _mm512_dpbusd_epi32(sum, u, i);
+#else
     const vepi16 p = _mm512_maddubs_epi16(u, i);
     const vepi32 w = _mm512_madd_epi16(p, set_i16(1));
     return _mm512_add_epi32(sum, w);
+#endif
 }
 
+} // namespace SIMD_ISA
 } // namespace simd
 
 #endif
@@ -27,6 +27,7 @@
 #include <cstdint>
 
 namespace simd {
+inline namespace SIMD_ISA {
 
 constexpr size_t PACKUS_LANE_COUNT = 1;
 constexpr size_t PACKUS_LANE_ORDER[2] = {0, 0};
@@ -80,6 +81,9 @@ inline vepi16 set_i16(const int16_t v) { return vdupq_n_s16(v); }
 
 inline vepi16 load_i16(const void* ptr) { return vld1q_s16(static_cast<const int16_t*>(ptr)); }
 
+// Loads CHUNK_SIZE_16BIT int8, sign extended
+inline vepi16 load_widen_i8(const void* ptr) { return vmovl_s8(vld1_s8(static_cast<const int8_t*>(ptr))); }
+
 inline void store_i16(void* ptr, vepi16 v) { vst1q_s16(static_cast<int16_t*>(ptr), v); }
 
 inline vepi16 min_i16(const vepi16 v, const vepi16 min) { return vminq_s16(v, min); }
@@ -167,6 +171,7 @@ inline vepi32 dpbusd_i32(vepi32 sum, vepu8 u, vepi8 i) {
 #endif
 }
 
+} // namespace SIMD_ISA
 } // namespace simd
 
 #endif
@@ -18,18 +18,20 @@
 
 #pragma once
 
+#include <array>
 #include <bit>
-#include <limits>
-
-#if USE_SIMD
-
 #include <cassert>
 #include <cstddef>
 #include <cstdint>
+#include <limits>
 
 #include "eval/nnue/arch.h"
 #include "eval/nnue/simd.h"
 
+inline namespace SIMD_ISA {
+
+#if USE_SIMD
+
 class SparseIterator {
   public:
     inline size_t count() const { return m_count; }
@@ -107,3 +109,5 @@ class SparseIterator {
 class SparseIterator {};
 
 #endif // #if USE_SIMD
+
+} // namespace SIMD_ISA
@@ -0,0 +1,138 @@
+/*
+ *  Minke is a UCI chess engine
+ *  Copyright (C) 2026 Eduardo Marinho <eduardomarinho@pm.me>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "eval/nnue/update.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <utility>
+
+#include "eval/nnue/arch.h"
+#include "eval/nnue/simd.h"
+
+namespace Update {
+inline namespace SIMD_ISA {
+
+/// Multiplier of the weights of the feature starting at 'feature', always 1 unless they are stored in int8. Read once
+/// per update, as the compiler can't hoist it past stores to the neurons
+static inline int16_t ft_scale([[maybe_unused]] const size_t feature) {
+#if USE_FT_INT8
+    return network->ft_scales[feature / L1_SIZE];
+#else
+    return 1;
+#endif
+}
+
+/// Loads, updates and stores one register of each perspective per step, so with both perspectives their independent
+/// chains of adds overlap
+template <size_t POV_COUNT, size_t ADD_COUNT, size_t SUB_COUNT>
+static void update(int16_t *const *outputs, const int16_t *const *inputs, const size_t *adds, const size_t *subs) {
+#if USE_SIMD
+    using namespace simd;
+
+    // Loads the weights of one register, widening and scaling them if they are stored in int8
+    const auto load_weights = [](const size_t feature, const size_t column, [[maybe_unused]] const vepi16 scale) {
+#if USE_FT_INT8
+        return mullo_i16(load_widen_i8(&network->ft_weights[feature + column]), scale);
+#else
+        return load_i16(&network->ft_weights[feature + column]);
+#endif
+    };
+    // Sized at least one so the arrays stay valid for updates without adds or subs
+    vepi16 add_scales[std::max<size_t>(ADD_COUNT, 1)][POV_COUNT];
+    vepi16 sub_scales[std::max<size_t>(SUB_COUNT, 1)][POV_COUNT];
+    for (size_t pov = 0; pov < POV_COUNT; ++pov) {
+        for (size_t add = 0; add < ADD_COUNT; ++add)
+            add_scales[add][pov] = set_i16(ft_scale(adds[add * POV_COUNT + pov]));
+        for (size_t sub = 0; sub < SUB_COUNT; ++sub)
+            sub_scales[sub][pov] = set_i16(ft_scale(subs[sub * POV_COUNT + pov]));
+    }
+
+    for (size_t column = 0; column < L1_SIZE; column += CHUNK_SIZE_16BIT) {
+        for (size_t pov = 0; pov < POV_COUNT; ++pov) {
+            vepi16 neurons = load_i16(&inputs[pov][column]);
+            for (size_t add = 0; add < ADD_COUNT; ++add)
+                neurons = add_i16(neurons, load_weights(adds[add * POV_COUNT + pov], column, add_scales[add][pov]));
+            for (size_t sub = 0; sub < SUB_COUNT; ++sub)
+                neurons = sub_i16(neurons, load_weights(subs[sub * POV_COUNT + pov], column, sub_scales[sub][pov]));
+            store_i16(&outputs[pov][column], neurons);
+        }
+    }
+#else
+    for (size_t pov = 0; pov < POV_COUNT; ++pov) {
+        int16_t add_scales[std::max<size_t>(ADD_COUNT, 1)];
+        int16_t sub_scales[std::max<size_t>(SUB_COUNT, 1)];
+        for (size_t add = 0; add < ADD_COUNT; ++add)
+            add_scales[add] = ft_scale(adds[add * POV_COUNT + pov]);
+        for (size_t sub = 0; sub < SUB_COUNT; ++sub)
+            sub_scales[sub] = ft_scale(subs[sub * POV_COUNT + pov]);
+
+        for (int column{0}; column < L1_SIZE; ++column) {
+            int16_t neurons = inputs[pov][column];
+            for (size_t add = 0; add < ADD_COUNT; ++add)
+                neurons += add_scales[add] * network->ft_weights[adds[add * POV_COUNT + pov] + column];
+            for (size_t sub = 0; sub < SUB_COUNT; ++sub)
+                neurons -= sub_scales[sub] * network->ft_weights[subs[sub * POV_COUNT + pov] + column];
+            outputs[pov][column] = neurons;
+        }
+    }
+#endif
+}
+
+static void apply(int16_t *output, const int16_t *input, std::span<const size_t> adds, std::span<const size_t> subs) {
+    // Small enough for a tile to stay in registers while every feature is applied to it
+    constexpr int TILE_SIZE = 128;
+    static_assert(L1_SIZE % TILE_SIZE == 0);
+
+    for (int tile{0}; tile < L1_SIZE; tile += TILE_SIZE) {
+        int16_t neurons[TILE_SIZE];
+        std::memcpy(neurons, &input[tile], sizeof(neurons));
+        for (const size_t add : adds) {
+            const int16_t scale = ft_scale(add);
+            for (int column{0}; column < TILE_SIZE; ++column)
+                neurons[column] += scale * network->ft_weights[add + tile + column];
+        }
+        for (const size_t sub : subs) {
+            const int16_t scale = ft_scale(sub);
+            for (int column{0}; column < TILE_SIZE; ++column)
+                neurons[column] -= scale * network->ft_weights[sub + tile + column];
+        }
+        std::memcpy(&output[tile], neurons, sizeof(neurons));
+    }
+}
+
+/// Every combination of perspective, add and sub counts, at the index of Kernels::update
+template <size_t... INDICES>
+static constexpr Kernels make_kernels(std::index_sequence<INDICES...>) {
+    constexpr size_t COUNTS = MAX_FEATURE_COUNT + 1;
+    Kernels table{};
+    ((table.update[INDICES / (COUNTS * COUNTS)][INDICES / COUNTS % COUNTS][INDICES % COUNTS] =
+          update<INDICES / (COUNTS * COUNTS) + 1, INDICES / COUNTS % COUNTS, INDICES % COUNTS>),
+     ...);
+    table.apply = apply;
+    return table;
+}
+
+const Kernels kernels =
+    make_kernels(std::make_index_sequence<MAX_POV_COUNT * (MAX_FEATURE_COUNT + 1) * (MAX_FEATURE_COUNT + 1)>());
+
+} // namespace SIMD_ISA
+} // namespace Update
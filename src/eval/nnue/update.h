@@ -0,0 +1,52 @@
+/*
+ *  Minke is a UCI chess engine
+ *  Copyright (C) 2026 Eduardo Marinho <eduardomarinho@pm.me>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+#include "eval/nnue/simd.h"
+
+namespace Update {
+
+constexpr size_t MAX_POV_COUNT = 2;
+constexpr size_t MAX_FEATURE_COUNT = 2;
+
+/// Adds the weights of some features to the neurons of one or both perspectives and subtracts those of others, in a
+/// single pass over the columns. Features are indexed by [feature * pov count + pov]
+using UpdateFn = void (*)(int16_t *const *outputs, const int16_t *const *inputs, const size_t *adds,
+                          const size_t *subs);
+
+/// Applies any number of feature changes to one perspective, each column is loaded and stored only once
+using ApplyFn = void (*)(int16_t *output, const int16_t *input, std::span<const size_t> adds,
+                         std::span<const size_t> subs);
+
+/// One build of the feature transformer updates
+struct Kernels {
+    UpdateFn update[MAX_POV_COUNT][MAX_FEATURE_COUNT + 1][MAX_FEATURE_COUNT + 1]; // by [povs - 1][adds][subs]
+    ApplyFn apply;
+};
+
+inline namespace SIMD_ISA {
+
+extern const Kernels kernels;
+
+} // namespace SIMD_ISA
+} // namespace Update
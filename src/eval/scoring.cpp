@@ -0,0 +1,94 @@
+/*
+ *  Minke is a UCI chess engine
+ *  Copyright (C) 2026 Eduardo Marinho <eduardomarinho@pm.me>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "eval/scoring.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstddef>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "core/position.h"
+#include "core/types.h"
+#include "eval/nnue.h"
+#include "eval/nnue/arch.h"
+
+// Positions evaluated per eval_batch call. The kernel propagates groups of positions that share an output bucket and
+// falls back to one position at a time for the rest, so the positions are sorted by bucket before being batched
+constexpr size_t SCORING_BATCH_SIZE = 64;
+
+// The output bucket of a FEN, computed from its piece count the same way NNUE does
+static int output_bucket(const std::string &fen) {
+    const std::string_view board(fen.data(), std::min(fen.find(' '), fen.size()));
+    const int piece_count = std::count_if(board.begin(), board.end(), [](unsigned char c) { return std::isalpha(c); });
+    return std::clamp((piece_count - 2) / BUCKET_SIZE, 0, OUTPUT_BUCKET_COUNT - 1);
+}
+
+std::vector<std::optional<ScoreType>> score_positions(const std::vector<std::string> &fens, int thread_count) {
+    thread_count = std::max(thread_count, 1);
+    std::vector<std::optional<ScoreType>> scores(fens.size());
+
+    // Blocks of consecutive indices then share a bucket, so only the blocks that straddle two buckets leave positions
+    // outside of full groups
+    std::vector<size_t> order(fens.size());
+    std::vector<int> buckets(fens.size());
+    for (size_t idx = 0; idx < fens.size(); ++idx) {
+        order[idx] = idx;
+        buckets[idx] = output_bucket(fens[idx]);
+    }
+    std::stable_sort(order.begin(), order.end(), [&](size_t lhs, size_t rhs) { return buckets[lhs] < buckets[rhs]; });
+
+    std::vector<std::thread> threads;
+    for (int id = 0; id < thread_count; ++id) {
+        threads.emplace_back([&, id] {
+            std::unique_ptr<NNUE> nnue = std::make_unique<NNUE>();
+            std::vector<Position> positions(SCORING_BATCH_SIZE);
+            std::vector<const Position *> batch;
+            std::vector<size_t> batch_indices;
+            ScoreType batch_scores[SCORING_BATCH_SIZE];
+
+            // Every thread takes blocks of consecutive positions in bucket order
+            for (size_t start = id * SCORING_BATCH_SIZE; start < fens.size();
+                 start += thread_count * SCORING_BATCH_SIZE) {
+                batch.clear();
+                batch_indices.clear();
+                for (size_t rank = start; rank < std::min(start + SCORING_BATCH_SIZE, fens.size()); ++rank) {
+                    Position &pos = positions[batch.size()];
+                    if (!pos.set_fen(fens[order[rank]]))
+                        continue;
+                    batch.push_back(&pos);
+                    batch_indices.push_back(order[rank]);
+                }
+
+                nnue->eval_batch(batch, std::span(batch_scores, batch.size()));
+                for (size_t batch_idx = 0; batch_idx < batch.size(); ++batch_idx)
+                    scores[batch_indices[batch_idx]] = batch_scores[batch_idx];
+            }
+        });
+    }
+
+    for (std::thread &thread : threads)
+        thread.join();
+    return scores;
+}
@@ -16,13 +16,24 @@
  *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
  */
 
+#include <algorithm>
 #include <cstdlib>
 #include <filesystem>
+#include <fstream>
+#include <iostream>
 #include <optional>
+#include <string>
+#include <thread>
+#include <vector>
 
+#include "core/movegen.h"
+#include "core/types.h"
 #include "datagen/datagen.h"
+#include "eval/nnue/activations.h"
+#include "eval/scoring.h"
 #include "uci/init.h"
 #include "uci/uci.h"
+#include "utils/fen_corpus.h"
 
 int main(int argc, char *argv[]) {
     init_all();
@@ -33,6 +44,26 @@ int main(int argc, char *argv[]) {
 
         UCI uci;
         uci.bench(depth);
+    } else if (argc > 1 && std::string(argv[1]) == "bench-nnue") {
+        int rounds = 20;
+        if (argc > 2)
+            rounds = std::stoi(argv[2]);
+
+        UCI uci;
+        uci.nnue_bench(rounds);
+    } else if (argc > 1 && std::string(argv[1]) == "bench-movegen") {
+        const bool pseudo_legal = argc > 2 && std::string(argv[2]) == "pseudo";
+
+        UCI uci;
+        if (!uci.movegen_bench(pseudo_legal ? Movegen::PSEUDO_LEGAL : Movegen::LEGAL))
+            return EXIT_FAILURE;
+    } else if (argc > 1 && std::string(argv[1]) == "bench-makemove") {
+        int rounds = 200;
+        if (argc > 2)
+            rounds = std::stoi(argv[2]);
+
+        UCI uci;
+        uci.make_move_bench(rounds);
     } else if (argc > 1 && std::string(argv[1]) == "datagen") {
         if (argc != 4 && argc != 5) {
             std::cerr << "usage: " << argv[0] << " datagen <threads> <output_directory> [opening_book.epd]\n";
@@ -45,6 +76,69 @@ int main(int argc, char *argv[]) {
 
         DatagenEngine dt_engine;
         dt_engine.datagen_loop(concurrency, EngineOptions::HASH_DEFAULT, directory, opening_book);
+    } else if (argc > 1 && std::string(argv[1]) == "activations") {
+        if (argc < 3 || argc > 6) {
+            std::cerr << "usage: " << argv[0] << " activations <fen_file> [threads] [evalfile] [output_file]\n";
+            return EXIT_FAILURE;
+        }
+
+        const int concurrency = argc > 3 ? std::stoi(argv[3]) : std::thread::hardware_concurrency();
+        std::string error;
+        if (argc > 4 && !load_network(argv[4], error)) {
+            std::cerr << "Failed to load network " << argv[4] << ": " << error << '\n';
+            return EXIT_FAILURE;
+        }
+        // The counts are read back in the order the neurons were trained in
+        if (argc > 5 && network_trailer->permutation_hash != 0) {
+            std::cerr << "Counts are collected from nets processed with 'none', " << argv[4]
+                      << " has its neurons reordered\n";
+            return EXIT_FAILURE;
+        }
+
+        const std::vector<std::string> fens = read_fen_corpus(argv[2]);
+        if (fens.empty()) {
+            std::cerr << "No positions read from " << argv[2] << '\n';
+            return EXIT_FAILURE;
+        }
+
+        const ActivationStats stats = collect_activations(fens, concurrency);
+        std::cout << stats.positions << " positions, average nnz " << stats.average_nnz() << " of " << L1_SIZE / 4
+                  << " chunks\n";
+        if (argc > 5 && !stats.write(argv[5])) {
+            std::cerr << "Failed to write activation counts to " << argv[5] << '\n';
+            return EXIT_FAILURE;
+        }
+    } else if (argc > 1 && std::string(argv[1]) == "score") {
+        if (argc < 3 || argc > 5) {
+            std::cerr << "usage: " << argv[0] << " score <fen_file> [threads] [output_file]\n";
+            return EXIT_FAILURE;
+        }
+
+        const int concurrency = argc > 3 ? std::stoi(argv[3]) : std::thread::hardware_concurrency();
+        const std::vector<std::string> fens = read_fen_corpus(argv[2]);
+        const TimeType start_time = now();
+        const std::vector<std::optional<ScoreType>> scores = score_positions(fens, concurrency);
+        const TimeType elapsed = std::max<TimeType>(now() - start_time, 1);
+
+        std::ofstream out_file;
+        if (argc > 4)
+            out_file.open(argv[4]);
+        std::ostream &out = argc > 4 ? out_file : std::cout;
+        // Positions that set_fen rejects are left out of the output
+        size_t rejected = 0;
+        for (size_t idx = 0; idx < fens.size(); ++idx) {
+            if (scores[idx])
+                out << fens[idx] << " | " << *scores[idx] << '\n';
+            else
+                ++rejected;
+        }
+        if (!out) {
+            std::cerr << "Failed to write scores\n";
+            return EXIT_FAILURE;
+        }
+
+        std::cerr << "info positions " << fens.size() - rejected << " rejected " << rejected << " time " << elapsed
+                  << "ms positions/s " << fens.size() * 1000 / elapsed << '\n';
     } else {
         UCI uci;
         uci.loop();
@@ -26,6 +26,14 @@
 #include "search/search.h"
 #include "uci/tune.h"
 
+// Legality of the moves generated outside the root. Pseudo legal generation checks pins only once a move is picked,
+// but has not shown a gain yet, so it is opt-in
+#if defined(MOVEPICKER_PSEUDO_LEGAL)
+constexpr Movegen::GenLegality SEARCH_LEGALITY = Movegen::PSEUDO_LEGAL;
+#else
+constexpr Movegen::GenLegality SEARCH_LEGALITY = Movegen::LEGAL;
+#endif
+
 MovePicker::MovePicker(Move ttmove, ThreadData &td, int ply, MovePickerType mp_type, ScoreType threshold) {
     init(ttmove, td, ply, mp_type, threshold);
 }
@@ -60,7 +68,10 @@ Move MovePicker::next_move(bool skip_quiets) {
             }
             [[fallthrough]];
         case GEN_NOISY:
-            Movegen::noisies(m_move_list, m_td->position);
+            if (m_ply == 0)
+                Movegen::noisies<Movegen::LEGAL>(m_move_list, m_td->position);
+            else
+                Movegen::noisies<SEARCH_LEGALITY>(m_move_list, m_td->position);
             m_end = m_move_list.size();
             score_noisy_moves();
             m_stage = PICK_GOOD_NOISY;
@@ -75,7 +86,7 @@ Move MovePicker::next_move(bool skip_quiets) {
 
                 if (!Engine::SEE(m_td->position, move, see_threshold)) // Bad noisy
                     m_move_list[m_bad_noisy_end++] = m_move_list[idx];
-                else if (move != m_ttmove)
+                else if (move != m_ttmove && is_legal(move))
                     return move;
             }
             if ((m_mp_type == QSEARCH && skip_quiets) || m_mp_type == PROBCUT) {
@@ -92,7 +103,10 @@ Move MovePicker::next_move(bool skip_quiets) {
             }
             [[fallthrough]];
         case GEN_QUIET:
-            Movegen::quiets(m_move_list, m_td->position);
+            if (m_ply == 0)
+                Movegen::quiets<Movegen::LEGAL>(m_move_list, m_td->position);
+            else
+                Movegen::quiets<SEARCH_LEGALITY>(m_move_list, m_td->position);
             m_end = m_move_list.size();
             score_quiet_moves();
             m_stage = PICK_QUIET;
@@ -102,7 +116,7 @@ Move MovePicker::next_move(bool skip_quiets) {
                 size_t idx = sort_next_move();
                 const auto [move, score] = m_move_list[idx];
 
-                if (move != m_ttmove)
+                if (move != m_ttmove && is_legal(move))
                     return move;
             }
             m_idx = 0;
@@ -112,7 +126,7 @@ Move MovePicker::next_move(bool skip_quiets) {
             while (m_idx != m_bad_noisy_end) {
                 // No need to call 'sort_next_move', since bad noisy moves are already sorted in PickGoodNoisy
                 const auto [move, score] = m_move_list[m_idx++];
-                if (move != m_ttmove)
+                if (move != m_ttmove && is_legal(move))
                     return move;
             }
             m_stage = FINISHED;
@@ -124,6 +138,10 @@ Move MovePicker::next_move(bool skip_quiets) {
     }
 }
 
+bool MovePicker::is_legal(const Move move) const {
+    return SEARCH_LEGALITY == Movegen::LEGAL || m_ply == 0 || Movegen::is_legal_pseudo(m_td->position, move);
+}
+
 size_t MovePicker::sort_next_move() {
     size_t best_move_idx = m_idx;
     for (size_t i = m_idx + 1; i < m_end; ++i) {
@@ -53,6 +53,8 @@ class MovePicker {
     MovePickerStage picker_stage() const { return m_stage; }
 
   private:
+    /// With pseudo legal generation outside the root, the legality of moves is checked only once they are picked
+    bool is_legal(const Move move) const;
     size_t sort_next_move();
     void score_quiet_moves();
     void score_noisy_moves();
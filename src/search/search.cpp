@@ -20,6 +20,7 @@
 
 #include <algorithm>
 #include <cassert>
+#include <chrono>
 #include <cmath>
 #include <cstdint>
 #include <cstdlib>
@@ -34,6 +35,7 @@
 #include "search/movepicker.h"
 #include "search/tt.h"
 #include "uci/tune.h"
+#include "utils/numa.h"
 
 void SearchStackEntry::init() {
     curr_pmove = PieceMove::none();
@@ -44,7 +46,14 @@ void SearchStackEntry::init() {
 }
 
 void ThreadData::init() {
-    nodes_searched = 0;
+    nodes_searched.reset();
+    nodes_flushed = 0;
+    tt_probes = 0;
+    tt_hits = 0;
+    eval_cache.reset_stats();
+    completed_depth = 0;
+    best_move = Move::none();
+    best_score = -MAX_SCORE;
     std::memset(node_table, 0, sizeof(node_table));
     for (int i = 0; i < MAX_SEARCH_DEPTH; ++i)
         search_stack[i].init();
@@ -60,10 +69,10 @@ Engine::Engine() {
 void Engine::new_game() {
     clear_tt();
     m_search_limiter.init();
-    for (auto &m_td : m_threads_data) {
-        m_td.search_history.reset();
-        m_td.correction_history.reset();
-        m_td.init();
+    for (auto &td : m_threads_data) {
+        td->search_history.reset();
+        td->correction_history.reset();
+        td->init();
     }
     m_main_thread_data->search_history.reset();
     m_main_thread_data->correction_history.reset();
@@ -72,44 +81,124 @@ void Engine::new_game() {
 
 void Engine::prepare_search() {
     for (auto &td : m_threads_data) {
-        td.init();
+        td->init();
     }
     m_main_thread_data->init();
 }
 
 void Engine::prepare_search(const Position &pos) {
     for (auto &td : m_threads_data) {
-        td.position = pos;
-        td.nnue.refresh(pos);
-        td.init();
+        td->position = pos;
+        td->nnue.refresh(pos);
+        td->init();
     }
     m_main_thread_data->position = pos;
     m_main_thread_data->nnue.refresh(pos);
     m_main_thread_data->init();
 }
 
+static int64_t now_us() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
 std::pair<Move, ScoreType> Engine::search() {
-    assert(m_threads.size() == m_threads_data.size());
+    m_stop_time = 0;
+    m_stop = false;
+    return run_search();
+}
 
+void Engine::start_search() {
+    // Clear the stop flag before handing the search to the main worker, so that a stop command received right after
+    // this returns can not be overwritten by the worker
+    m_stop_time = 0;
     m_stop = false;
+    m_main_thread.run([this] { run_search(); });
+}
+
+void Engine::wait_until_idle() { m_main_thread.wait(); }
+
+void Engine::stop_search() {
+    if (!m_stop.exchange(true))
+        m_stop_time = now_us();
+}
+
+std::pair<Move, ScoreType> Engine::run_search() {
+    assert(m_threads.size() == m_threads_data.size());
+
+    for (std::atomic<int> &searchers : m_depth_searchers)
+        searchers = 0;
+    m_global_nodes = 0;
+
     for (size_t i = 0; i < m_threads.size(); ++i) {
-        m_threads[i] = std::thread(&Engine::iterative_deepening, this, std::ref(m_threads_data[i]));
+        m_threads[i]->run([this, i] { iterative_deepening(*m_threads_data[i]); });
     }
-    const auto search_result = iterative_deepening(*m_main_thread_data);
+    iterative_deepening(*m_main_thread_data);
+    // Not a stop request, a search that finishes on its own has no stop latency
     m_stop = true;
 
     m_tt.update_age();
 
-    wait_until_idle(); // join helper threads
+    wait_helpers();
+
+    const ThreadData &best_td = vote_best_thread();
+    if (m_report) {
+        if (m_stop_time != 0)
+            std::cout << "info string stop latency " << now_us() - m_stop_time << "us\n";
+        report_search_result(best_td.position, best_td.best_move);
+    }
 
-    return search_result;
+    return {best_td.best_move, best_td.best_score};
 }
 
-void Engine::wait_until_idle() {
-    for (auto &t : m_threads) {
-        if (t.joinable()) {
-            t.join();
+const ThreadData &Engine::vote_best_thread() const {
+    const ThreadData *best_td = m_main_thread_data.get();
+    if (m_threads_data.empty() || best_td->completed_depth == 0)
+        return *best_td;
+
+    // Every thread votes for its best move, weighted by the depth it completed and by how its score compares to the
+    // worst one among all threads
+    ScoreType min_score = MAX_SCORE;
+    for (size_t idx = 0; idx < thread_count(); ++idx) {
+        if (td(idx).completed_depth > 0)
+            min_score = std::min(min_score, td(idx).best_score);
+    }
+
+    std::vector<std::pair<Move, int64_t>> votes;
+    const auto votes_of = [&](const Move move) -> int64_t & {
+        for (auto &[voted_move, count] : votes) {
+            if (voted_move == move)
+                return count;
         }
+        return votes.emplace_back(move, 0).second;
+    };
+    for (size_t idx = 0; idx < thread_count(); ++idx) {
+        const ThreadData &thread = td(idx);
+        if (thread.completed_depth > 0)
+            votes_of(thread.best_move) += (thread.best_score - min_score + 14) * thread.completed_depth;
+    }
+
+    for (size_t idx = 1; idx < thread_count(); ++idx) {
+        const ThreadData &thread = td(idx);
+        if (thread.completed_depth == 0 || !thread.best_move)
+            continue;
+
+        const int64_t thread_votes = votes_of(thread.best_move);
+        const int64_t best_votes = votes_of(best_td->best_move);
+        // A proven result overrides the votes
+        const bool better = is_decisive(best_td->best_score)
+                                ? thread.best_score > best_td->best_score
+                                : is_mate(thread.best_score) || thread_votes > best_votes ||
+                                      (thread_votes == best_votes && thread.completed_depth > best_td->completed_depth);
+        if (better)
+            best_td = &thread;
+    }
+    return *best_td;
+}
+
+void Engine::wait_helpers() {
+    for (auto &t : m_threads) {
+        t->wait();
     }
 }
 
@@ -117,36 +206,136 @@ void Engine::resize_threads(size_t new_size) {
     assert(new_size >= 1);
 
     --new_size; // the caller thread is already a search thread, so -1
-    m_threads.resize(new_size);
+    while (m_threads.size() > new_size)
+        m_threads.pop_back();
+    while (m_threads.size() < new_size)
+        m_threads.push_back(std::make_unique<WorkerThread>());
     m_threads_data.resize(new_size);
 
+    // Every helper (un)binds itself and then allocates its own ThreadData, so that when NUMA awareness is enabled the
+    // first touch of its memory happens on the node it will search on
+    for (size_t i = 0; i < m_threads.size(); ++i) {
+        m_threads[i]->run([this, i] {
+            m_numa_aware ? Numa::bind_thread(i + 1) : Numa::unbind_thread();
+            m_threads_data[i] = allocate_thread_data(i + 1);
+        });
+    }
+    wait_helpers();
+}
+
+void Engine::numa_aware(bool enabled) {
+    if (enabled == m_numa_aware)
+        return;
+    m_numa_aware = enabled;
+
+    m_tt.numa_interleave(enabled);
+    resize_tt(m_tt.tt_size_mb());
+
+    // The main search runs on m_main_thread, so its data is reallocated from there as well
+    m_main_thread.run([this] {
+        m_numa_aware ? Numa::bind_thread(0) : Numa::unbind_thread();
+        m_main_thread_data = allocate_thread_data(0);
+    });
+    m_main_thread.wait();
+
+    resize_threads(m_threads.size() + 1);
+}
+
+void Engine::huge_tlb(bool enabled) {
+    m_tt.huge_tlb(enabled);
+    resize_tt(m_tt.tt_size_mb());
+}
+
+void Engine::resize_tt(size_t MB) {
+    m_tt.resize(MB);
+    clear_tt();
+}
+
+void Engine::clear_tt() {
+    // Split the table among the idle search threads, the caller takes the first slice
+    const size_t slice_count = m_threads.size() + 1;
+    for (size_t i = 0; i < m_threads.size(); ++i) {
+        m_threads[i]->run([this, i, slice_count] { m_tt.clear(i + 1, slice_count); });
+    }
+    m_tt.clear(0, slice_count);
+    wait_helpers();
+}
+
+void Engine::resize_eval_cache(size_t MB) {
+    m_eval_cache_mb = MB;
+
+    // Like the rest of their ThreadData, every cache is allocated by the thread that uses it
+    for (size_t i = 0; i < m_threads.size(); ++i) {
+        m_threads[i]->run([this, i] { m_threads_data[i]->eval_cache.resize(m_eval_cache_mb); });
+    }
+    m_main_thread.run([this] { m_main_thread_data->eval_cache.resize(m_eval_cache_mb); });
+    wait_helpers();
+    m_main_thread.wait();
+}
+
+void Engine::reset_nnue() {
+    for (auto &td : m_threads_data) {
+        td->nnue.reset();
+        td->eval_cache.clear();
+    }
+    m_main_thread_data->nnue.reset();
+    m_main_thread_data->eval_cache.clear();
+}
+
+std::unique_ptr<ThreadData> Engine::allocate_thread_data(size_t id) const {
     // SAFETY: m_main_thread_data is guaranteed to have been allocated by the constructor, so its safe to
     // dereference it
     const ThreadData &main_td = *m_main_thread_data;
-    for (size_t i = 0; i < m_threads_data.size(); ++i) {
-        m_threads_data[i].id = i + 1;
-        m_threads_data[i].position = main_td.position;
-        m_threads_data[i].nnue = main_td.nnue;
-        m_threads_data[i].init();
-    }
+
+    std::unique_ptr<ThreadData> td = std::make_unique<ThreadData>();
+    td->id = id;
+    td->position = main_td.position;
+    td->nnue = main_td.nnue;
+    td->eval_cache.resize(m_eval_cache_mb);
+    td->init();
+    return td;
 }
 
 size_t Engine::nodes_searched() const {
-    size_t total_nodes = m_main_thread_data->nodes_searched;
+    size_t total_nodes = m_main_thread_data->nodes_searched.load();
     for (const auto &td : m_threads_data) {
-        total_nodes += td.nodes_searched;
+        total_nodes += td->nodes_searched.load();
     }
     return total_nodes;
 }
 
+int64_t Engine::tt_probes() const {
+    int64_t total_probes = m_main_thread_data->tt_probes;
+    for (const auto &td : m_threads_data) {
+        total_probes += td->tt_probes;
+    }
+    return total_probes;
+}
+
+int64_t Engine::tt_hits() const {
+    int64_t total_hits = m_main_thread_data->tt_hits;
+    for (const auto &td : m_threads_data) {
+        total_hits += td->tt_hits;
+    }
+    return total_hits;
+}
+
 std::pair<Move, ScoreType> Engine::iterative_deepening(ThreadData &td) {
     Move past_best_move = Move::none();
     ScoreType past_score = -MAX_SCORE;
     ScoreType avg_score = SCORE_NONE;
     CounterType pv_stability = 0;
     CounterType score_stability = 0;
-    for (CounterType depth = 1; depth <= std::min(m_search_limiter.max_depth(), MAX_SEARCH_DEPTH - 1); ++depth) {
+    const CounterType max_depth = std::min(m_search_limiter.max_depth(), MAX_SEARCH_DEPTH - 1);
+    const int skip_threshold = std::max<int>(1, thread_count() / 2);
+    for (CounterType depth = 1; depth <= max_depth; ++depth) {
+        // Helpers skip the depths that enough threads are already searching, which also staggers their start depths
+        if (!td.is_main() && depth < max_depth && m_depth_searchers[depth] >= skip_threshold)
+            continue;
+
+        ++m_depth_searchers[depth];
         const ScoreType score = aspiration(depth, past_score, td);
+        --m_depth_searchers[depth];
         const Move best_move = td.search_stack[0].pv_list.best_move();
         if (time_over(td)) // Search did not finished completely
             break;
@@ -171,6 +360,9 @@ std::pair<Move, ScoreType> Engine::iterative_deepening(ThreadData &td) {
 
         past_best_move = best_move;
         past_score = score;
+        td.completed_depth = depth;
+        td.best_move = best_move;
+        td.best_score = score;
         if (!past_best_move) // No legal moves
             break;
 
@@ -180,20 +372,16 @@ std::pair<Move, ScoreType> Engine::iterative_deepening(ThreadData &td) {
 
             if (depth > 5) {
                 const double node_fraction =
-                    td.node_table[best_move.from_and_to()] / static_cast<double>(td.nodes_searched);
+                    td.node_table[best_move.from_and_to()] / static_cast<double>(td.nodes_searched.load());
                 m_search_limiter.update(pv_stability, score_stability, node_fraction);
             }
-            if (m_search_limiter.stop_early(td.nodes_searched))
+            if (m_search_limiter.stop_early(nodes_searched()))
                 break;
 
             m_search_limiter.can_stop(); // Avoids stopping before depth 1 has been searched through
         }
     }
 
-    if (m_report && td.is_main()) {
-        report_search_result(td.position, past_best_move);
-    }
-
     return {past_best_move, past_score};
 }
 
@@ -239,7 +427,7 @@ ScoreType Engine::negamax(ScoreType alpha, ScoreType beta, CounterType depth, Co
         return -MAX_SCORE;
     if (depth <= 0)
         return quiescence(alpha, beta, ply, td);
-    ++td.nodes_searched;
+    count_node(td);
 
     const bool pv_node = alpha != beta - 1;
     const Move excluded_move = td.search_stack[ply].excluded_move;
@@ -255,12 +443,12 @@ ScoreType Engine::negamax(ScoreType alpha, ScoreType beta, CounterType depth, Co
             return 0;
 
         if (ply >= MAX_SEARCH_DEPTH - 1)
-            return position.in_check() ? 0 : td.nnue.eval(position);
+            return position.in_check() ? 0 : evaluate(td);
 
         // Upcoming repetition detection
         if (alpha < 0 && position.has_upcoming_repetition(ply)) {
             if (!in_check) {
-                const ScoreType raw_eval = td.nnue.eval(td.position);
+                const ScoreType raw_eval = evaluate(td);
                 const HistoryType correction = td.correction_history.correction(td, ply);
                 const ScoreType adjusted_eval = adjust_eval(td.position, raw_eval, correction);
                 td.correction_history.update(td, depth, ply, 0 - adjusted_eval);
@@ -281,6 +469,8 @@ ScoreType Engine::negamax(ScoreType alpha, ScoreType beta, CounterType depth, Co
     TTEntry tte;
 
     const bool tthit = !singular_search && m_tt.probe(position, tte); // Don't use ttentry result if in singular search
+    td.tt_probes += !singular_search;
+    td.tt_hits += tthit;
 
     // Extraction data from ttentry if tthit
     const Move ttmove = (tthit ? tte.best_move() : Move::none());
@@ -314,7 +504,7 @@ ScoreType Engine::negamax(ScoreType alpha, ScoreType beta, CounterType depth, Co
     } else if (singular_search) {
         eval = raw_eval = node.static_eval;
     } else if (tthit) {
-        raw_eval = tteval != SCORE_NONE ? tteval : td.nnue.eval(position);
+        raw_eval = tteval != SCORE_NONE ? tteval : evaluate(td);
         eval = node.static_eval = adjust_eval(position, raw_eval, correction_value);
         if (ttscore != SCORE_NONE                        //
             && (ttbound == EXACT                         //
@@ -325,7 +515,7 @@ ScoreType Engine::negamax(ScoreType alpha, ScoreType beta, CounterType depth, Co
         }
 
     } else {
-        raw_eval = td.nnue.eval(position);
+        raw_eval = evaluate(td);
         eval = node.static_eval = adjust_eval(position, raw_eval, correction_value);
         m_tt.store(position.hash(), 0, Move::none(), SCORE_NONE, raw_eval, BOUND_EMPTY, ttpv, m_tt.age());
     }
@@ -544,7 +734,7 @@ ScoreType Engine::negamax(ScoreType alpha, ScoreType beta, CounterType depth, Co
 
         ++moves_searched;
 
-        const int64_t nodes_before_search = td.nodes_searched;
+        const int64_t nodes_before_search = td.nodes_searched.load();
         td.search_stack[ply + 1].pv_list.clear();
         ScoreType score;
         if (moves_searched == 1) {
@@ -591,7 +781,7 @@ ScoreType Engine::negamax(ScoreType alpha, ScoreType beta, CounterType depth, Co
 
         unmake_move(td, move);
         assert(score >= -MAX_SCORE);
-        td.node_table[move.from_and_to()] += td.nodes_searched - nodes_before_search;
+        td.node_table[move.from_and_to()] += td.nodes_searched.load() - nodes_before_search;
 
         if (score > best_score) {
             best_score = score;
@@ -633,21 +823,21 @@ ScoreType Engine::negamax(ScoreType alpha, ScoreType beta, CounterType depth, Co
 }
 
 ScoreType Engine::quiescence(ScoreType alpha, ScoreType beta, CounterType ply, ThreadData &td) {
-    ++td.nodes_searched;
+    count_node(td);
     Position &position = td.position;
     if (time_over(td))
         return -MAX_SCORE;
     else if (position.is_draw())
         return 0;
     else if (ply >= MAX_SEARCH_DEPTH - 1)
-        return position.in_check() ? 0 : td.nnue.eval(position);
+        return position.in_check() ? 0 : evaluate(td);
 
     const bool in_check = position.in_check();
 
     // Upcoming repetition detection
     if (alpha < 0 && position.has_upcoming_repetition(ply)) {
         if (!in_check) {
-            const ScoreType raw_eval = td.nnue.eval(td.position);
+            const ScoreType raw_eval = evaluate(td);
             const HistoryType correction = td.correction_history.correction(td, ply);
             const ScoreType adjusted_eval = adjust_eval(td.position, raw_eval, correction);
             td.correction_history.update(td, 1, ply, 0 - adjusted_eval);
@@ -662,6 +852,8 @@ ScoreType Engine::quiescence(ScoreType alpha, ScoreType beta, CounterType ply, T
 
     TTEntry tte;
     const bool tthit = m_tt.probe(position, tte);
+    ++td.tt_probes;
+    td.tt_hits += tthit;
     const Move ttmove = tthit ? tte.best_move() : Move::none();
     const ScoreType ttscore = tthit ? tte.score() : SCORE_NONE;
     const ScoreType tteval = tthit ? tte.eval() : SCORE_NONE;
@@ -682,7 +874,7 @@ ScoreType Engine::quiescence(ScoreType alpha, ScoreType beta, CounterType ply, T
         node.static_eval = raw_eval = SCORE_NONE;
         best_score = -MAX_SCORE;
     } else if (tthit) {
-        raw_eval = tteval != SCORE_NONE ? tteval : td.nnue.eval(position);
+        raw_eval = tteval != SCORE_NONE ? tteval : evaluate(td);
         best_score = node.static_eval = adjust_eval(position, raw_eval, td.correction_history.correction(td, ply));
 
         if (ttscore != SCORE_NONE                              //
@@ -694,7 +886,7 @@ ScoreType Engine::quiescence(ScoreType alpha, ScoreType beta, CounterType ply, T
         }
 
     } else {
-        raw_eval = td.nnue.eval(position);
+        raw_eval = evaluate(td);
         best_score = node.static_eval = adjust_eval(position, raw_eval, td.correction_history.correction(td, ply));
         m_tt.store(position.hash(), 0, Move::none(), SCORE_NONE, raw_eval, BOUND_EMPTY, ttpv, m_tt.age());
     }
@@ -847,7 +1039,7 @@ void Engine::report_search_info(const CounterType &depth, const ScoreType &eval,
 
     // Add 1 to time_passed() to avoid division by 0
     std::cout << " time " << m_search_limiter.time_passed() << " nodes " << nodes << " nps "
-              << nodes * 1000 / (m_search_limiter.time_passed() + 1) << " pv ";
+              << nodes * 1000 / (m_search_limiter.time_passed() + 1) << " hashfull " << m_tt.hashfull() << " pv ";
 
     pv_list.print(pos);
     std::cout << std::endl;
@@ -18,21 +18,24 @@
 
 #pragma once
 
+#include <array>
+#include <atomic>
 #include <cstddef>
 #include <cstdint>
 #include <memory>
-#include <thread>
 #include <vector>
 
 #include "core/move.h"
 #include "core/position.h"
 #include "core/types.h"
+#include "eval/eval_cache.h"
 #include "eval/nnue.h"
 #include "search/correction.h"
 #include "search/history.h"
 #include "search/pv_list.h"
 #include "search/search_limiter.h"
 #include "search/tt.h"
+#include "search/worker_thread.h"
 
 constexpr int LMP_DEPTH = 32;
 extern int LMP_TABLE[2][LMP_DEPTH];
@@ -48,18 +51,44 @@ struct SearchStackEntry {
     inline void init();
 };
 
+/// Written by its owner thread only and polled by the others. It fills a whole cache line, so the polling never slows
+/// down the owner
+struct alignas(64) NodeCounter {
+    std::atomic<int64_t> nodes{0};
+
+    inline int64_t load() const { return nodes.load(std::memory_order_relaxed); }
+    // A single writer doesn't need a locked increment
+    inline int64_t increment() {
+        const int64_t value = load() + 1;
+        nodes.store(value, std::memory_order_relaxed);
+        return value;
+    }
+    inline void reset() { nodes.store(0, std::memory_order_relaxed); }
+};
+
 struct ThreadData {
     size_t id;
 
     Position position;
     NNUE nnue;
+    EvalCache eval_cache;
     History search_history;
     CorrectionHistory correction_history;
     SearchStackEntry search_stack[MAX_SEARCH_DEPTH];
 
-    int64_t nodes_searched;
+    NodeCounter nodes_searched;
+    int64_t nodes_flushed; // part of nodes_searched already added to the engine global count
+    // Only written by the owner thread, and every ThreadData is a separate allocation, so the counters of different
+    // threads never share a cache line
+    int64_t tt_probes;
+    int64_t tt_hits;
     int64_t node_table[64 * 64];
 
+    // Result of the deepest iteration completed, used to vote for the best move among all threads
+    CounterType completed_depth;
+    Move best_move;
+    ScoreType best_score;
+
     void init();
     inline bool is_main() const { return id == 0; }
 };
@@ -78,6 +107,17 @@ inline void make_null_move(ThreadData &td) { td.position.make_null_move(); }
 
 inline void unmake_null_move(ThreadData &td) { td.position.unmake_null_move(); }
 
+/// Raw network output for the position of the thread, taken from its eval cache when possible
+inline ScoreType evaluate(ThreadData &td) {
+    ScoreType eval;
+    if (td.eval_cache.probe(td.position.hash(), eval))
+        return eval;
+
+    eval = td.nnue.eval(td.position);
+    td.eval_cache.store(td.position.hash(), eval);
+    return eval;
+}
+
 class Engine {
   public:
     Engine();
@@ -89,47 +129,86 @@ class Engine {
     inline void limit_search(const SearchLimits &sl) { m_search_limiter.init(sl); }
 
     std::pair<Move, ScoreType> search();
-    inline void stop_search() { m_stop = true; }
-    inline bool stopped() const { return m_stop; }
+    void start_search();
+    /// Can be called from any thread, the first call of a search records when the search was asked to stop, for an
+    /// external stop or a limit hit
+    void stop_search();
+    inline bool stopped() const { return m_stop.load(std::memory_order_relaxed); }
     void wait_until_idle();
 
     void resize_threads(size_t new_size);
-    void resize_tt(size_t MB) { m_tt.resize(MB); }
-    void clear_tt() { m_tt.clear(); }
+    void numa_aware(bool enabled);
+    void huge_tlb(bool enabled);
+    void resize_tt(size_t MB);
+    /// Size of the eval cache of each thread, 0 disables it
+    void resize_eval_cache(size_t MB);
+    void clear_tt();
+    /// Must be called after the network changes, followed by prepare_search()
+    void reset_nnue();
+    TranspositionTable &tt() { return m_tt; }
 
     void report(bool r) { m_report = r; }
 
     inline ScoreType static_eval() { return m_main_thread_data->nnue.eval(m_main_thread_data->position); }
     size_t nodes_searched() const;
+    int64_t tt_probes() const;
+    int64_t tt_hits() const;
 
     Position &position() { return m_main_thread_data->position; }
     const Position &position() const { return m_main_thread_data->position; }
     ThreadData &main_td() { return *m_main_thread_data; }
     const ThreadData &main_td() const { return *m_main_thread_data; }
+    size_t thread_count() const { return m_threads_data.size() + 1; }
+    /// Thread 0 is the main thread, the others are the helpers
+    const ThreadData &td(size_t idx) const { return idx == 0 ? main_td() : *m_threads_data[idx - 1]; }
 
     static bool SEE(Position &position, const Move &move, int threshold);
 
   private:
+    std::pair<Move, ScoreType> run_search();
+    void wait_helpers();
+    std::unique_ptr<ThreadData> allocate_thread_data(size_t id) const;
+    const ThreadData &vote_best_thread() const;
+
     std::pair<Move, ScoreType> iterative_deepening(ThreadData &td);
     ScoreType aspiration(const CounterType &depth, const ScoreType prev_score, ThreadData &td);
     ScoreType negamax(ScoreType alpha, ScoreType beta, CounterType depth, CounterType ply, const bool cutnode,
                       ThreadData &td);
     ScoreType quiescence(ScoreType alpha, ScoreType beta, CounterType ply, ThreadData &td);
 
-    inline bool time_over(const ThreadData &td) {
-        return m_stop || (td.is_main() && m_search_limiter.time_over(td.nodes_searched));
+    inline bool time_over(const ThreadData &) const { return m_stop.load(std::memory_order_relaxed); }
+
+    /// Every thread enforces the node and time limits against the nodes searched by all threads, which it reads from
+    /// a global count the threads add their own nodes to every NODE_BATCH nodes
+    inline void count_node(ThreadData &td) {
+        const int64_t nodes = td.nodes_searched.increment();
+        if (nodes - td.nodes_flushed >= NODE_BATCH) {
+            m_global_nodes.fetch_add(nodes - td.nodes_flushed, std::memory_order_relaxed);
+            td.nodes_flushed = nodes;
+        }
+        if (m_search_limiter.time_over(m_global_nodes.load(std::memory_order_relaxed) + nodes - td.nodes_flushed))
+            stop_search();
     }
 
     void report_search_info(const CounterType &depth, const ScoreType &eval, const PvList &pv_list,
                             const Position &pos);
     void report_search_result(const Position &pos, Move best_move);
 
-    std::vector<std::thread> m_threads;
-    std::vector<ThreadData> m_threads_data;
+    std::vector<std::unique_ptr<WorkerThread>> m_threads;
+    std::vector<std::unique_ptr<ThreadData>> m_threads_data;
     std::unique_ptr<ThreadData> m_main_thread_data;
     SearchLimiter m_search_limiter;
     TranspositionTable m_tt;
+    std::array<std::atomic<int>, MAX_SEARCH_DEPTH> m_depth_searchers{}; // threads searching each depth
 
-    bool m_stop{true};
+    static constexpr int64_t NODE_BATCH = 512;
+    alignas(64) std::atomic<uint64_t> m_global_nodes{0};
+    alignas(64) std::atomic<bool> m_stop{true};
+    std::atomic<int64_t> m_stop_time{0}; // microseconds, steady clock, 0 until a stop is requested
     bool m_report{true};
+    bool m_numa_aware{false};
+    size_t m_eval_cache_mb{0};
+
+    // Declared last so it is destroyed first, i.e. joined while the state a running search uses is still alive
+    WorkerThread m_main_thread;
 };
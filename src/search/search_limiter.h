@@ -18,6 +18,7 @@
 
 #pragma once
 
+#include <atomic>
 #include <cstdint>
 #include <optional>
 
@@ -67,5 +68,5 @@ class SearchLimiter {
 
     bool m_movetime;
     bool m_time_set;
-    bool m_can_stop;
+    std::atomic<bool> m_can_stop; // set by the main thread, read by every thread
 };
@@ -18,67 +18,91 @@
 
 #include "search/tt.h"
 
+#include <algorithm>
+#include <cassert>
 #include <cstddef>
+#include <cstdio>
 #include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <ios>
 #include <iostream>
+#include <limits>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+#if defined(__linux__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
 
 #include "core/move.h"
 #include "core/position.h"
 #include "core/types.h"
+#include "utils/numa.h"
+#include "utils/random.h"
 #include "utils/utils.h"
 
-inline static KeyType key_from_hash(const HashType &hash) { return static_cast<KeyType>(hash); }
-
-void TTEntry::store(const HashType &hash, const IndexType &depth, const Move &best_move, const ScoreType &score,
-                    const ScoreType &eval, const BoundType &bound, const bool was_pv, const IndexType age,
-                    const bool &tthit) {
+template <typename Key>
+void BasicTTEntry<Key>::store(const HashType &hash, const IndexType &depth, const Move &best_move,
+                              const ScoreType &score, const ScoreType &eval, const BoundType &bound, const bool was_pv,
+                              const IndexType age, const bool &tthit) {
     if (best_move || !tthit)
         m_best_move = best_move;
 
     if (!tthit || bound == EXACT || depth + 4 + 2 * was_pv > m_depth || age != this->age()) {
-        m_key = key_from_hash(hash);
         m_depth = depth;
         m_score = score;
         m_eval = eval;
         m_age_pv_bound = (age << AGE_OFFSET) + (was_pv << PV_OFFSET) + bound;
     }
+    m_key = key_from_hash(hash) ^ checksum();
 }
 
-void TTEntry::reset() {
-    m_key = 0;
+template <typename Key>
+void BasicTTEntry<Key>::reset() {
     m_depth = 0;
     m_best_move = Move::none();
     m_score = SCORE_NONE;
     m_eval = SCORE_NONE;
     m_age_pv_bound = 0;
+    m_key = checksum(); // encodes key 0
 }
 
-size_t TranspositionTable::table_index_from_hash(const HashType hash) {
+template <typename Entry, size_t BucketSize>
+size_t BasicTranspositionTable<Entry, BucketSize>::table_index_from_hash(const HashType hash) {
     using u128 = unsigned __int128;
     return static_cast<uint64_t>((static_cast<u128>(hash) * static_cast<u128>(m_table_size)) >> 64);
 }
 
-bool TranspositionTable::probe(const Position &position, TTEntry &tte) {
-    size_t table_index = table_index_from_hash(position.hash());
-    for (TTEntry &entry : m_table[table_index].entry) {
-        tte = entry;
-        if (tte.key() == key_from_hash(position.hash()))
+template <typename Entry, size_t BucketSize>
+bool BasicTranspositionTable<Entry, BucketSize>::probe(const HashType hash, Entry &tte) {
+    size_t table_index = table_index_from_hash(hash);
+    for (const Entry &entry : m_table[table_index].entry) {
+        tte = entry; // validate a private copy, the shared entry may be rewritten at any moment
+        if (tte.key() == Entry::key_from_hash(hash))
             return true;
     }
     return false;
 }
 
-void TranspositionTable::store(const HashType &hash, const IndexType &depth, const Move &best_move,
-                               const ScoreType &score, const ScoreType &eval, const BoundType &bound, const bool was_pv,
-                               const IndexType age) {
+template <typename Entry, size_t BucketSize>
+void BasicTranspositionTable<Entry, BucketSize>::store(const HashType &hash, const IndexType &depth,
+                                                       const Move &best_move, const ScoreType &score,
+                                                       const ScoreType &eval, const BoundType &bound, const bool was_pv,
+                                                       const IndexType age) {
     size_t table_index = table_index_from_hash(hash);
-    KeyType target_key = key_from_hash(hash);
+    const typename Entry::EntryKey target_key = Entry::key_from_hash(hash);
     TTBucket *bucket = &m_table[table_index];
-    TTEntry *replace = &bucket->entry[0];
+    Entry *replace = &bucket->entry[0];
 
     bool tthit = false;
-    for (IndexType index = 0; index < BUCKET_SIZE; ++index) {
-        TTEntry *curr = &bucket->entry[index];
+    for (size_t index = 0; index < BucketSize; ++index) {
+        Entry *curr = &bucket->entry[index];
         if (curr->key() == target_key) {
             replace = curr;
             tthit = true;
@@ -92,38 +116,268 @@ void TranspositionTable::store(const HashType &hash, const IndexType &depth, con
     replace->store(hash, depth, best_move, score, eval, bound, was_pv, age, tthit);
 }
 
-void TranspositionTable::prefetch(const HashType &key) {
+template <typename Entry, size_t BucketSize>
+void BasicTranspositionTable<Entry, BucketSize>::prefetch(const HashType &key) {
     size_t table_index = table_index_from_hash(key);
     __builtin_prefetch(&m_table[table_index]);
 }
 
-TranspositionTable::~TranspositionTable() {
-    if (m_table != nullptr)
-        aligned_free(m_table);
+template <typename Entry, size_t BucketSize>
+BasicTranspositionTable<Entry, BucketSize>::~BasicTranspositionTable() { free_table(); }
+
+template <typename Entry, size_t BucketSize>
+void BasicTranspositionTable<Entry, BucketSize>::free_table() {
+    if (m_table == nullptr)
+        return;
+
+#if defined(__linux__)
+    if (m_file_mapped)
+        munmap(m_table, m_table_size * sizeof(TTBucket));
+    else
+#endif
+        large_page_free(m_table, m_table_size * sizeof(TTBucket), m_mapped);
 
     m_table = nullptr;
+    m_file_mapped = false;
 }
 
-void TranspositionTable::resize(size_t MB) {
-    if (m_table != nullptr)
-        aligned_free(m_table);
+template <typename Entry, size_t BucketSize>
+void BasicTranspositionTable<Entry, BucketSize>::resize(size_t MB) {
+    free_table();
 
     size_mb = MB;
     m_table_size = MB * 1024 * 1024 / sizeof(TTBucket);
-    m_table = static_cast<TTBucket *>(aligned_malloc(sizeof(TTBucket), m_table_size * sizeof(TTBucket)));
+    m_table = static_cast<TTBucket *>(large_page_alloc(m_table_size * sizeof(TTBucket), m_huge_tlb, m_mapped));
     if (!m_table) {
         std::cerr << "Failed to allocated required memory for the transposition table" << std::endl;
         exit(EXIT_FAILURE);
     }
+    if (m_numa_interleave) // must happen before the table is cleared, i.e. before its pages are touched
+        Numa::interleave(m_table, m_table_size * sizeof(TTBucket));
+}
 
-    clear();
+template <typename Entry, size_t BucketSize>
+void BasicTranspositionTable<Entry, BucketSize>::clear(size_t slice, size_t slice_count) {
+    assert(slice < slice_count);
+
+    const size_t slice_size = m_table_size / slice_count;
+    const size_t begin = slice * slice_size;
+    const size_t end = slice == slice_count - 1 ? m_table_size : begin + slice_size;
+
+    if (slice == 0)
+        m_age = 0;
+    for (size_t index = begin; index < end; ++index) {
+        for (Entry &entry : m_table[index].entry) {
+            entry.reset();
+        }
+    }
 }
 
-void TranspositionTable::clear() {
-    m_age = 0;
+template <typename Entry, size_t BucketSize>
+int BasicTranspositionTable<Entry, BucketSize>::hashfull() const {
+    constexpr size_t SAMPLE_SIZE = 1000;
+
+    const size_t sample_size = std::min(SAMPLE_SIZE, m_table_size * BucketSize);
+    size_t used = 0;
+    for (size_t index = 0; index < sample_size; ++index) {
+        const Entry &entry = m_table[index / BucketSize].entry[index % BucketSize];
+        used += !entry.empty() && entry.age() == m_age;
+    }
+    return static_cast<int>(used * 1000 / std::max<size_t>(sample_size, 1));
+}
+
+template <typename Entry, size_t BucketSize>
+TTStats BasicTranspositionTable<Entry, BucketSize>::stats() const {
+    TTStats stats;
     for (size_t index = 0; index < m_table_size; ++index) {
-        for (TTEntry &entry : m_table[index].entry) {
-            entry.reset();
+        for (const Entry &entry : m_table[index].entry) {
+            ++stats.entries;
+            if (entry.empty())
+                continue;
+
+            ++stats.used;
+            ++stats.age_histogram[(MAX_AGE + m_age - entry.age()) & AGE_MASK];
+            ++stats.depth_histogram[entry.depth()];
+            ++stats.bound_histogram[entry.bound()];
         }
     }
+    return stats;
 }
+
+template <typename Entry, size_t BucketSize>
+bool BasicTranspositionTable<Entry, BucketSize>::save(const std::string &path) const {
+    // The table may be a private mapping of 'path' itself, so truncating that file would pull the pages from under it.
+    // Writing a new file and renaming it over the old one leaves the mapped inode untouched
+    const std::string tmp_path = path + ".tmp";
+    std::ofstream file(tmp_path, std::ios::binary);
+    if (!file)
+        return false;
+
+    FileHeader header{};
+    std::memcpy(header.magic, FILE_MAGIC, sizeof(FILE_MAGIC));
+    header.version = FILE_VERSION;
+    header.layout = FILE_LAYOUT;
+    header.table_size = m_table_size;
+    header.age = m_age;
+
+    std::vector<char> padding(FILE_TABLE_OFFSET - sizeof(FileHeader), 0);
+    file.write(reinterpret_cast<const char *>(&header), sizeof(FileHeader));
+    file.write(padding.data(), padding.size());
+    file.write(reinterpret_cast<const char *>(m_table), m_table_size * sizeof(TTBucket));
+    file.close();
+    if (!file || std::rename(tmp_path.c_str(), path.c_str()) != 0) {
+        std::remove(tmp_path.c_str());
+        return false;
+    }
+    return true;
+}
+
+template <typename Entry, size_t BucketSize>
+bool BasicTranspositionTable<Entry, BucketSize>::map_file([[maybe_unused]] const std::string &path) {
+#if defined(__linux__)
+    const int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        return false;
+
+    // A private mapping is copy-on-write: pages are read lazily from the file and the search never writes back to it
+    void *ptr = mmap(nullptr, m_table_size * sizeof(TTBucket), PROT_READ | PROT_WRITE, MAP_PRIVATE, fd,
+                     FILE_TABLE_OFFSET);
+    close(fd);
+    if (ptr == MAP_FAILED)
+        return false;
+
+    free_table();
+    m_table = static_cast<TTBucket *>(ptr);
+    m_file_mapped = true;
+    return true;
+#else
+    return false;
+#endif
+}
+
+template <typename Entry, size_t BucketSize>
+bool BasicTranspositionTable<Entry, BucketSize>::load(const std::string &path) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file)
+        return false;
+
+    FileHeader header;
+    file.read(reinterpret_cast<char *>(&header), sizeof(FileHeader));
+    if (!file || std::memcmp(header.magic, FILE_MAGIC, sizeof(FILE_MAGIC)) != 0 || header.version != FILE_VERSION ||
+        header.layout != FILE_LAYOUT)
+        return false;
+
+    std::error_code error;
+    const uint64_t file_size = std::filesystem::file_size(path, error);
+    if (error || header.table_size == 0 || file_size != FILE_TABLE_OFFSET + header.table_size * sizeof(TTBucket))
+        return false;
+
+    if (header.table_size == m_table_size && map_file(path)) {
+        m_age = header.age & AGE_MASK;
+        return true;
+    }
+
+    clear();
+    m_age = header.age & AGE_MASK;
+    file.seekg(FILE_TABLE_OFFSET);
+
+    // Only the bucket index and the low bits of the hash (the entry key) survive in the file, so the remaining bits are
+    // taken from the middle of the range of hashes that map to the saved bucket. Entries keep their bucket when the
+    // table shrinks, but when it grows only those whose hash actually falls on the chosen bucket stay reachable
+    using EntryKey = typename Entry::EntryKey;
+    const auto rebuild_hash = [&](const uint64_t bucket_index, const EntryKey key) {
+        using u128 = unsigned __int128;
+        const u128 bucket_middle = (static_cast<u128>(bucket_index) << 64) + (static_cast<u128>(1) << 63);
+        const HashType hash = static_cast<HashType>(bucket_middle / header.table_size);
+        return (hash & ~static_cast<HashType>(std::numeric_limits<EntryKey>::max())) | key;
+    };
+
+    std::vector<TTBucket> chunk(1 << 15);
+    for (uint64_t first = 0; first < header.table_size; first += chunk.size()) {
+        const size_t count = std::min<uint64_t>(chunk.size(), header.table_size - first);
+        file.read(reinterpret_cast<char *>(chunk.data()), count * sizeof(TTBucket));
+        if (!file)
+            return false;
+
+        for (size_t index = 0; index < count; ++index) {
+            for (const Entry &entry : chunk[index].entry) {
+                if (entry.bound() == BOUND_EMPTY)
+                    continue;
+                store(rebuild_hash(first + index, entry.key()), entry.depth(), entry.best_move(), entry.score(),
+                      entry.eval(), static_cast<BoundType>(entry.bound()), entry.was_pv(), entry.age());
+            }
+        }
+    }
+    return true;
+}
+
+template <typename Entry, size_t BucketSize>
+TTStressReport BasicTranspositionTable<Entry, BucketSize>::stress(size_t thread_count, uint64_t probes_per_thread) {
+    constexpr size_t HASH_POOL_SIZE = 1 << 16;
+
+    // A small table and a small pool of hashes, so that threads keep fighting over the same buckets
+    BasicTranspositionTable tt;
+    tt.resize(1);
+    tt.clear();
+
+    std::vector<HashType> hash_pool(HASH_POOL_SIZE);
+    PRNG pool_prng(0x9e3779b97f4a7c15ULL);
+    for (HashType &hash : hash_pool)
+        hash = pool_prng.rand<HashType>();
+
+    // Every write of a given hash stores exactly these contents
+    const auto contents = [](const HashType hash) {
+        Entry entry;
+        entry.reset();
+        entry.store(hash, (hash >> 16) & 63,
+                    Move(static_cast<Square>((hash >> 22) & 63), static_cast<Square>((hash >> 28) & 63), REGULAR),
+                    static_cast<ScoreType>((hash >> 34) & 1023) - 512,
+                    static_cast<ScoreType>((hash >> 44) & 1023) - 512,
+                    static_cast<BoundType>(1 + (hash >> 54) % 3), (hash >> 60) & 1, 0, false);
+        return entry;
+    };
+
+    std::vector<TTStressReport> reports(thread_count, TTStressReport{0, 0, 0, 0});
+    std::vector<std::thread> threads;
+    for (size_t thread_idx = 0; thread_idx < thread_count; ++thread_idx) {
+        threads.emplace_back([&, thread_idx] {
+            TTStressReport &report = reports[thread_idx];
+            PRNG prng(thread_idx + 1);
+
+            for (uint64_t i = 0; i < probes_per_thread; ++i) {
+                const HashType store_hash = hash_pool[prng.rand<size_t>() % HASH_POOL_SIZE];
+                const Entry to_store = contents(store_hash);
+                tt.store(store_hash, to_store.depth(), to_store.best_move(), to_store.score(), to_store.eval(),
+                         static_cast<BoundType>(to_store.bound()), to_store.was_pv(), 0);
+
+                const HashType probe_hash = hash_pool[prng.rand<size_t>() % HASH_POOL_SIZE];
+                const Entry expected = contents(probe_hash);
+                ++report.probes;
+                for (const Entry &shared : tt.m_table[tt.table_index_from_hash(probe_hash)].entry) {
+                    const Entry entry = shared;
+                    if (entry.key() == Entry::key_from_hash(probe_hash)) {
+                        ++report.hits;
+                        report.torn_undetected += !(entry == expected);
+                        break;
+                    }
+                    // Right encoded key, but the remaining fields come from another write
+                    report.torn_detected += entry.m_key == expected.m_key;
+                }
+            }
+        });
+    }
+    for (std::thread &thread : threads)
+        thread.join();
+
+    TTStressReport total{0, 0, 0, 0};
+    for (const TTStressReport &report : reports) {
+        total.probes += report.probes;
+        total.hits += report.hits;
+        total.torn_detected += report.torn_detected;
+        total.torn_undetected += report.torn_undetected;
+    }
+    return total;
+}
+
+template class BasicTTEntry<TTEntry::EntryKey>;
+template class BasicTranspositionTable<TTEntry, TranspositionTable::bucket_size()>;
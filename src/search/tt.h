@@ -19,17 +19,45 @@
 #pragma once
 
 #include <array>
+#include <bit>
 #include <cstddef>
+#include <cstdint>
+#include <string>
 
 #include "core/position.h"
 #include "core/types.h"
 
-class TTEntry {
+struct TTStressReport {
+    uint64_t probes;
+    uint64_t hits;
+    uint64_t torn_detected;   // torn entries rejected by the key verification
+    uint64_t torn_undetected; // torn entries that were accepted, should be (almost) always 0
+};
+
+struct TTStats {
+    static constexpr size_t AGE_COUNT = 32;
+    static constexpr size_t DEPTH_COUNT = 256;
+
+    uint64_t entries{0};
+    uint64_t used{0};
+    std::array<uint64_t, AGE_COUNT> age_histogram{}; // indexed by how many searches ago the entry was written
+    std::array<uint64_t, DEPTH_COUNT> depth_histogram{};
+    std::array<uint64_t, 4> bound_histogram{}; // indexed by BoundType
+};
+
+/// Entries are shared by all search threads without any locking, so a reader can see the fields of two different
+/// writes mixed together. To detect that, the stored key is XORed with a checksum of the other fields, so a torn entry
+/// decodes to a key that (almost surely) doesn't match the probed position.
+/// 'Key' holds the low bits of the position hash, wider keys mean less false hits at the cost of bigger entries
+template <typename Key>
+class BasicTTEntry {
   public:
-    TTEntry() = default;
-    ~TTEntry() = default;
+    using EntryKey = Key;
+
+    BasicTTEntry() = default;
+    ~BasicTTEntry() = default;
 
-    KeyType key() const { return m_key; }
+    Key key() const { return m_key ^ checksum(); }
     IndexType depth() const { return m_depth; }
     Move best_move() const { return m_best_move; }
     ScoreType score() const { return m_score; }
@@ -37,19 +65,37 @@ class TTEntry {
     IndexType bound() const { return m_age_pv_bound & BOUND_MASK; }
     IndexType age() const { return (m_age_pv_bound & AGE_MASK) >> AGE_OFFSET; }
     bool was_pv() const { return m_age_pv_bound & PV_MASK; }
+    /// reset() encodes key 0, which a real position only has once every 2^(8 * sizeof(Key)) hashes
+    bool empty() const { return key() == 0; }
     void store(const HashType &hash, const IndexType &depth, const Move &best_move, const ScoreType &score,
                const ScoreType &eval, const BoundType &bound, const bool was_pv, const IndexType age,
                const bool &tthit);
     void reset();
 
+    bool operator==(const BasicTTEntry &) const = default;
+
+    static Key key_from_hash(const HashType &hash) { return static_cast<Key>(hash); }
+
   private:
+    template <typename Entry, size_t BucketSize>
+    friend class BasicTranspositionTable;
+
+    Key checksum() const {
+        const uint64_t data = static_cast<uint64_t>(std::bit_cast<uint16_t>(m_best_move))      //
+                              | static_cast<uint64_t>(static_cast<uint16_t>(m_score)) << 16 //
+                              | static_cast<uint64_t>(static_cast<uint16_t>(m_eval)) << 32  //
+                              | static_cast<uint64_t>(m_depth) << 48                        //
+                              | static_cast<uint64_t>(m_age_pv_bound) << 56;
+        return static_cast<Key>((data * 0x9E3779B97F4A7C15ull) >> (64 - 8 * sizeof(Key)));
+    }
+
     static constexpr IndexType BOUND_MASK = 0b0000'0011;
     static constexpr IndexType PV_MASK = 0b0000'0100;
     static constexpr IndexType PV_OFFSET = 2;
     static constexpr IndexType AGE_MASK = 0b1111'1000;
     static constexpr IndexType AGE_OFFSET = 3;
 
-    KeyType m_key;            // 2 bytes
+    Key m_key;                // 2 or 4 bytes: position key XOR checksum()
     Move m_best_move;         // 2 bytes
     ScoreType m_score;        // 2 bytes
     ScoreType m_eval;         // 2 bytes
@@ -57,42 +103,102 @@ class TTEntry {
     IndexType m_age_pv_bound; // 1 byte: 2 lower bits is for bound, 3rd bit for pv flag and others for entry age
 };
 
-class TranspositionTable {
-    constexpr static IndexType BUCKET_SIZE = 3;
-    struct alignas(32) TTBucket {
+static_assert(sizeof(BasicTTEntry<uint16_t>) == 10, "BasicTTEntry<uint16_t> is not 10 bytes");
+static_assert(sizeof(BasicTTEntry<uint32_t>) == 12, "BasicTTEntry<uint32_t> is not 12 bytes");
+
+/// Buckets are padded up to a power of two, so they never straddle a cache line
+template <typename Entry, size_t BucketSize>
+class BasicTranspositionTable {
+    static constexpr size_t BUCKET_BYTES = std::bit_ceil(BucketSize * sizeof(Entry));
+    struct alignas(BUCKET_BYTES) TTBucket {
         TTBucket() = default;
         ~TTBucket() = default;
-        std::array<TTEntry, BUCKET_SIZE> entry;
-        char padding[2];
+        std::array<Entry, BucketSize> entry;
     };
 
-    static_assert(sizeof(TTEntry) == 10, "TTEntry is not 10 bytes");
-    static_assert(sizeof(TTBucket) == 32, "TTBucket is not 32 bytes");
+    static_assert(sizeof(TTBucket) == BUCKET_BYTES, "TTBucket has unexpected padding");
+    static_assert(BUCKET_BYTES <= 64, "TTBucket is bigger than a cache line");
+
+    // Layout of a saved table: this header, zero padded up to FILE_TABLE_OFFSET, followed by the raw buckets. The
+    // offset is a multiple of every common page size, so the buckets can be mapped straight from the file
+    struct FileHeader {
+        char magic[8];
+        uint64_t version;
+        uint64_t layout;
+        uint64_t table_size;
+        uint64_t age;
+    };
+    static constexpr char FILE_MAGIC[8] = {'M', 'I', 'N', 'K', 'E', 'T', 'T', '\0'};
+    static constexpr uint64_t FILE_VERSION = 1;
+    static constexpr uint64_t FILE_LAYOUT = sizeof(Entry) << 8 | BucketSize; // tables of other layouts can't be read
+    static constexpr size_t FILE_TABLE_OFFSET = 1 << 16;
 
     size_t table_index_from_hash(const HashType hash);
+    bool map_file(const std::string &path);
+    void free_table();
 
   public:
-    TranspositionTable() = default;
-    ~TranspositionTable();
-    TranspositionTable(const TranspositionTable &) = delete;
-    TranspositionTable &operator=(const TranspositionTable &) = delete;
+    BasicTranspositionTable() = default;
+    ~BasicTranspositionTable();
+    BasicTranspositionTable(const BasicTranspositionTable &) = delete;
+    BasicTranspositionTable &operator=(const BasicTranspositionTable &) = delete;
 
-    bool probe(const Position &position, TTEntry &found);
+    bool probe(const HashType hash, Entry &found);
+    bool probe(const Position &position, Entry &found) { return probe(position.hash(), found); }
     void store(const HashType &hash, const IndexType &depth, const Move &best_move, const ScoreType &score,
                const ScoreType &eval, const BoundType &bound, const bool was_pv, const IndexType age);
     void update_age() { m_age = (m_age + 1) & AGE_MASK; }
+    /// Hammers a small table from 'thread_count' threads with entries whose contents are derived from their hash, so
+    /// that any entry mixing the fields of two writes can be recognized
+    static TTStressReport stress(size_t thread_count, uint64_t probes_per_thread);
     IndexType age() { return m_age; }
     void prefetch(const HashType &key);
+    /// Reallocates the table, which must be cleared afterwards
     void resize(size_t MB);
-    void clear();
+    /// Clears the 'slice'-th of 'slice_count' equal parts of the table, so that several threads can split the work
+    void clear(size_t slice = 0, size_t slice_count = 1);
+    /// Interleaves the table pages across NUMA nodes on the following resizes
+    void numa_interleave(bool interleave) { m_numa_interleave = interleave; }
+    /// Tries explicit hugetlbfs pages before transparent huge pages on the following resizes
+    void huge_tlb(bool enabled) { m_huge_tlb = enabled; }
     size_t tt_size_mb() const { return size_mb; }
+    /// Dumps the table and its age to 'path'
+    bool save(const std::string &path) const;
+    /// Loads a table saved by save(). When the saved table has the current size it is mapped from the file without
+    /// copying, otherwise its entries are streamed and reinserted into the current table
+    bool load(const std::string &path);
+
+    /// Permill of the table written during the current search, sampled from its first entries
+    int hashfull() const;
+    /// Scans the whole table, meant for debugging only
+    TTStats stats() const;
+
+    static constexpr size_t bucket_size() { return BucketSize; }
+    static constexpr size_t bucket_bytes() { return BUCKET_BYTES; }
 
   private:
     static constexpr IndexType MAX_AGE = 1 << 5;
     static constexpr IndexType AGE_MASK = MAX_AGE - 1;
+    static_assert(MAX_AGE == TTStats::AGE_COUNT);
 
     size_t size_mb{0};
     size_t m_table_size{0};
     TTBucket *m_table{nullptr};
     IndexType m_age{0};
+    bool m_numa_interleave{false};
+    bool m_huge_tlb{false};
+    bool m_mapped{false};
+    bool m_file_mapped{false};
 };
+
+// The layout is chosen at compile time, every layout is a separate build (see TT_LAYOUT in the makefile)
+#if defined(TT_LAYOUT_CACHELINE)
+using TTEntry = BasicTTEntry<uint16_t>; // 10 bytes, 6 per 64 byte bucket
+using TranspositionTable = BasicTranspositionTable<TTEntry, 6>;
+#elif defined(TT_LAYOUT_WIDE)
+using TTEntry = BasicTTEntry<uint32_t>; // 12 bytes, 5 per 64 byte bucket
+using TranspositionTable = BasicTranspositionTable<TTEntry, 5>;
+#else
+using TTEntry = BasicTTEntry<KeyType>; // 10 bytes, 3 per 32 byte bucket
+using TranspositionTable = BasicTranspositionTable<TTEntry, 3>;
+#endif
@@ -0,0 +1,66 @@
+/*
+ *  Minke is a UCI chess engine
+ *  Copyright (C) 2026 Eduardo Marinho <eduardomarinho@pm.me>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "search/worker_thread.h"
+
+#include <functional>
+#include <mutex>
+#include <utility>
+
+WorkerThread::WorkerThread() : m_thread(&WorkerThread::idle_loop, this) {}
+
+WorkerThread::~WorkerThread() {
+    {
+        std::lock_guard lock(m_mutex);
+        m_exit = true;
+    }
+    m_cv.notify_all();
+    m_thread.join();
+}
+
+void WorkerThread::run(std::function<void()> job) {
+    {
+        std::unique_lock lock(m_mutex);
+        m_cv.wait(lock, [&] { return !m_busy; });
+        m_job = std::move(job);
+        m_busy = true;
+    }
+    m_cv.notify_all();
+}
+
+void WorkerThread::wait() {
+    std::unique_lock lock(m_mutex);
+    m_cv.wait(lock, [&] { return !m_busy; });
+}
+
+void WorkerThread::idle_loop() {
+    while (true) {
+        std::unique_lock lock(m_mutex);
+        m_cv.wait(lock, [&] { return m_busy || m_exit; });
+        if (!m_busy) // exit was requested and there is no pending job
+            return;
+
+        lock.unlock();
+        m_job();
+        lock.lock();
+
+        m_job = nullptr;
+        m_busy = false;
+        m_cv.notify_all();
+    }
+}
@@ -0,0 +1,49 @@
+/*
+ *  Minke is a UCI chess engine
+ *  Copyright (C) 2026 Eduardo Marinho <eduardomarinho@pm.me>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+/// A long-lived thread that sleeps on a condition variable until a job is handed to it. Used by the Engine so that
+/// search threads are created once, when the thread count changes, instead of on every search.
+class WorkerThread {
+  public:
+    WorkerThread();
+    ~WorkerThread();
+    WorkerThread(const WorkerThread &) = delete;
+    WorkerThread &operator=(const WorkerThread &) = delete;
+
+    /// Hands 'job' to the worker and returns immediately. Waits for the previous job to finish, if there is one.
+    void run(std::function<void()> job);
+    /// Blocks until the worker has no job running.
+    void wait();
+
+  private:
+    void idle_loop();
+
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    std::function<void()> m_job;
+    bool m_busy{false};
+    bool m_exit{false};
+    std::thread m_thread;
+};
@@ -18,6 +18,7 @@
 
 #pragma once
 
+#include <cstdint>
 #include <string>
 #include <vector>
 
@@ -80,3 +81,41 @@ const std::vector<std::string> BENCHMARK_FEN_LIST = {
   "7k/7P/6K1/8/3B4/8/8/8 b - - 0 1",
 };
 // clang-format on
+
+struct PerftBenchmarkPosition {
+    std::string fen;
+    int depth;
+    uint64_t nodes;
+};
+
+// Known perft counts, from the Chess Programming Wiki and the perft suites shared on TalkChess. The 960 positions use
+// Shredder-FEN castling rights
+// clang-format off
+const std::vector<PerftBenchmarkPosition> PERFT_BENCHMARK_LIST = {
+  {"rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1", 6, 119060324},
+  // Kiwipete
+  {"r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1", 5, 193690690},
+  {"8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1", 6, 11030083},
+  {"r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1", 5, 15833292},
+  {"rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8", 4, 2103487},
+  {"r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10", 4, 3894594},
+  // En passant captures that are illegal because of pins, or that give check
+  {"3k4/3p4/8/K1P4r/8/8/8/8 b - - 0 1", 6, 1134888},
+  {"8/8/4k3/8/2p5/8/B2P2K1/8 w - - 0 1", 6, 1015133},
+  {"8/8/1k6/2b5/2pP4/8/5K2/8 b - d3 0 1", 6, 1440467},
+  // Castling that gives check, and castling rights lost to captures
+  {"5k2/8/8/8/8/8/8/4K2R w K - 0 1", 6, 661072},
+  {"3k4/8/8/8/8/8/8/R3K3 w Q - 0 1", 6, 803711},
+  {"r3k2r/1b4bq/8/8/8/8/7B/R3K2R w KQkq - 0 1", 4, 1274206},
+  {"r3k2r/8/3Q4/8/8/5q2/8/R3K2R b KQkq - 0 1", 4, 1720476},
+  // Promotions, out of and into check
+  {"2K2r2/4P3/8/8/8/8/8/3k4 w - - 0 1", 6, 3821001},
+  {"4k3/1P6/8/8/8/8/K7/8 w - - 0 1", 6, 217342},
+  {"8/P1k5/K7/8/8/8/8/8 w - - 0 1", 6, 92683},
+  {"8/k1P5/8/1K6/8/8/8/8 w - - 0 1", 7, 567584},
+  // Chess960 castling
+  {"bqnb1rkr/pp3ppp/3ppn2/2p5/5P2/P2P4/NPP1P1PP/BQ1BNRKR w HFhf - 2 9", 5, 8146062},
+  {"2nnrbkr/p1qppppp/8/1ppb4/6PP/3PP3/PPP2P2/BQNNRBKR w HEhe - 1 9", 5, 16253601},
+  {"b1q1rrkb/pppppppp/3nn3/8/P7/1PPP4/4PPPP/BQNNRKRB w GE - 1 9", 5, 6417013},
+};
+// clang-format on
@@ -18,21 +18,41 @@
 
 #include "uci/init.h"
 
+#include <cassert>
 #include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <ios>
+#include <string>
+
+#if defined(__linux__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 
 #include "core/attacks.h"
 #include "core/types.h"
 #include "eval/nnue/arch.h"
+#include "eval/nnue/dispatch.h"
+#include "eval/nnue/simd.h"
 #include "search/cuckoo.h"
 #include "search/search.h"
 #include "uci/tune.h"
+
+// Aligned as much as Network is, so the embedded net is used in place even in builds for baseline x86-64
+#define INCBIN_ALIGNMENT_INDEX 6
 #include "utils/incbin.h"
+#include "utils/utils.h"
 
 INCBIN(NetParameters, EVALFILE);
 
 int LMR_TABLE[64][64];
 int LMP_TABLE[2][LMP_DEPTH];
-Network network;
+const Network *network = nullptr;
+const NetworkTrailer *network_trailer = nullptr;
 
 Bitboard inbetween_masks[64][64];
 Bitboard passing_masks[64][64];
@@ -63,7 +83,174 @@ void init_search_params() {
     }
 }
 
-void init_network_params() { network = *reinterpret_cast<const Network *>(&gNetParametersData); }
+// The network file currently in use, if any, which load_network() releases when switching to another net
+static void *loaded_file = nullptr;
+static bool loaded_file_mapped = false;
+
+// Processed nets are the net followed by its trailer
+constexpr size_t NETWORK_FILE_SIZE = sizeof(Network) + sizeof(NetworkTrailer);
+
+/// The trailer of a processed net loaded at 'file'
+static const NetworkTrailer *file_trailer(const void *file) {
+    return reinterpret_cast<const NetworkTrailer *>(static_cast<const char *>(file) + sizeof(Network));
+}
+
+/// Describes the nets the kernels of this build read
+static NetworkTrailer build_trailer() {
+    NetworkTrailer trailer{};
+    std::memcpy(trailer.magic, NETWORK_MAGIC, sizeof(trailer.magic));
+    trailer.ft_weight_size = sizeof(Network::ft_weights[0]);
+#if USE_DISPATCH
+    trailer.packus_lane_count = Dispatch::kernels().packus_lane_count;
+    for (size_t lane = 0; lane < trailer.packus_lane_count; ++lane)
+        trailer.packus_lane_order[lane] = Dispatch::kernels().packus_lane_order[lane];
+#elif USE_SIMD
+    trailer.packus_lane_count = simd::PACKUS_LANE_COUNT;
+    for (size_t lane = 0; lane < simd::PACKUS_LANE_COUNT; ++lane)
+        trailer.packus_lane_order[lane] = simd::PACKUS_LANE_ORDER[lane];
+#else
+    trailer.packus_lane_count = 1;
+#endif
+    return trailer;
+}
+
+/// Why a net with 'trailer' can't be used by this build, empty if it can
+static std::string layout_error(const NetworkTrailer &trailer) {
+    const NetworkTrailer expected = build_trailer();
+    if (std::memcmp(trailer.magic, NETWORK_MAGIC, sizeof(NETWORK_MAGIC)) != 0)
+        return "not a net processed by preprocess_nnue";
+    if (trailer.ft_weight_size != expected.ft_weight_size)
+        return "its feature transformer weights are int" + std::to_string(8 * trailer.ft_weight_size) +
+               ", this build reads int" + std::to_string(8 * expected.ft_weight_size);
+#if USE_DISPATCH
+    // Nets laid out for any of the kernels are converted to the selected ones
+    if (!Dispatch::known_layout(trailer))
+#else
+    if (trailer.packus_lane_count != expected.packus_lane_count ||
+        std::memcmp(trailer.packus_lane_order, expected.packus_lane_order, sizeof(trailer.packus_lane_order)) != 0)
+#endif
+        return "its feature transformer is laid out for another instruction set";
+    return "";
+}
+
+/// The embedded net is used in place, so every process shares the read-only pages of the executable. It is only
+/// copied if the linker didn't align it as much as Network requires
+static const Network *embedded_network() {
+    assert(gNetParametersSize >= sizeof(Network));
+    if (reinterpret_cast<uintptr_t>(gNetParametersData) % alignof(Network) == 0)
+        return reinterpret_cast<const Network *>(gNetParametersData);
+
+    static Network *const copy = [] {
+        Network *net = static_cast<Network *>(aligned_malloc(alignof(Network), sizeof(Network)));
+        std::memcpy(static_cast<void *>(net), gNetParametersData, sizeof(Network));
+        return net;
+    }();
+    return copy;
+}
+
+/// The trailer of the embedded net, which was processed for this build. Nets embedded without one, as unprocessed
+/// nets are, get the one of this build
+static const NetworkTrailer *embedded_trailer() {
+    static const NetworkTrailer trailer = [] {
+        if (gNetParametersSize != NETWORK_FILE_SIZE)
+            return build_trailer();
+
+        NetworkTrailer embedded;
+        std::memcpy(&embedded, file_trailer(gNetParametersData), sizeof(NetworkTrailer));
+        return embedded;
+    }();
+    return &trailer;
+}
+
+/// Maps a preprocessed net read-only, so processes loading the same file share its pages in the page cache
+static const Network *map_network_file(const std::string &path, bool &mapped, std::string &error) {
+    mapped = false;
+#if defined(__linux__) || defined(__APPLE__)
+    const int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        error = "can't open the file";
+        return nullptr;
+    }
+
+    struct stat file_stat;
+    void *ptr = MAP_FAILED;
+    if (fstat(fd, &file_stat) == 0 && static_cast<size_t>(file_stat.st_size) == NETWORK_FILE_SIZE)
+        ptr = mmap(nullptr, NETWORK_FILE_SIZE, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (ptr == MAP_FAILED) {
+        error = "expected a processed net of " + std::to_string(NETWORK_FILE_SIZE) + " bytes";
+        return nullptr;
+    }
+
+    error = layout_error(*file_trailer(ptr));
+    if (!error.empty()) {
+        munmap(ptr, NETWORK_FILE_SIZE);
+        return nullptr;
+    }
+
+    mapped = true;
+    return static_cast<const Network *>(ptr);
+#else
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file || static_cast<size_t>(file.tellg()) != NETWORK_FILE_SIZE) {
+        error = "expected a processed net of " + std::to_string(NETWORK_FILE_SIZE) + " bytes";
+        return nullptr;
+    }
+
+    Network *net = static_cast<Network *>(aligned_malloc(alignof(Network), NETWORK_FILE_SIZE));
+    file.seekg(0);
+    if (!file.read(reinterpret_cast<char *>(net), NETWORK_FILE_SIZE)) {
+        error = "can't read the file";
+        aligned_free(net);
+        return nullptr;
+    }
+
+    error = layout_error(*file_trailer(net));
+    if (!error.empty()) {
+        aligned_free(net);
+        return nullptr;
+    }
+    return net;
+#endif
+}
+
+void init_network_params() {
+#if USE_DISPATCH
+    Dispatch::init();
+    network = Dispatch::adapt_network(embedded_network(), *embedded_trailer());
+#else
+    network = embedded_network();
+#endif
+    network_trailer = embedded_trailer();
+}
+
+bool load_network(const std::string &path, std::string &error) {
+    bool mapped = false;
+    const bool embedded = path.empty() || path == "<embedded>";
+    const Network *net = embedded ? embedded_network() : map_network_file(path, mapped, error);
+    if (net == nullptr)
+        return false;
+
+    if (loaded_file != nullptr) {
+#if defined(__linux__) || defined(__APPLE__)
+        if (loaded_file_mapped)
+            munmap(loaded_file, NETWORK_FILE_SIZE);
+        else
+#endif
+            aligned_free(loaded_file);
+    }
+
+    const NetworkTrailer *trailer = embedded ? embedded_trailer() : file_trailer(net);
+#if USE_DISPATCH
+    network = Dispatch::adapt_network(net, *trailer);
+#else
+    network = net;
+#endif
+    network_trailer = trailer;
+    loaded_file = embedded ? nullptr : const_cast<Network *>(net);
+    loaded_file_mapped = mapped;
+    return true;
+}
 
 void init_magic_attack_tables() {
     // This initializes all attacks, masks, magics and shifts for Bishop and Rook as a side effect
@@ -18,12 +18,18 @@
 
 #pragma once
 
+#include <string>
+
 void init_all();
 
 void init_search_params();
 
 void init_network_params();
 
+/// Switches to the preprocessed net at 'path', or back to the embedded one if 'path' is empty or "<embedded>". Must
+/// not be called while searching. Nets processed for another build are rejected, with the reason in 'error'
+bool load_network(const std::string &path, std::string &error);
+
 void init_magic_attack_tables();
 
 void init_inbetween_masks();
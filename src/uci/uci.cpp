@@ -18,21 +18,32 @@
 
 #include "uci/uci.h"
 
+#include <algorithm>
 #include <cassert>
+#include <chrono>
 #include <cstdint>
 #include <exception>
 #include <fstream>
+#include <iomanip>
 #include <ios>
 #include <iostream>
+#include <new>
+#include <numeric>
 #include <sstream>
 #include <string>
-#include <thread>
 #include <vector>
 
 #include "core/move.h"
 #include "core/movegen.h"
+#include "core/perft.h"
 #include "core/position.h"
 #include "core/types.h"
+#include "eval/nnue/accumulator.h"
+#include "eval/nnue/arch.h"
+#include "eval/nnue/dispatch.h"
+#include "eval/nnue/finny_table.h"
+#include "eval/nnue/forward.h"
+#include "eval/nnue/pov_accumulator.h"
 #include "search/movepicker.h"
 #include "search/search.h"
 #include "search/search_limiter.h"
@@ -40,11 +51,13 @@
 #include "uci/benchmark.h"
 #include "uci/init.h"
 #include "uci/tune.h"
+#include "utils/random.h"
 #include "utils/utils.h"
 
 UCI::UCI() {
     m_pos.set_fen(START_FEN);
     m_engine.resize_tt(EngineOptions::HASH_DEFAULT);
+    m_engine.resize_eval_cache(EngineOptions::EVAL_CACHE_DEFAULT);
     m_engine.new_game();
     m_engine.prepare_search(m_pos);
     m_engine.report(true);
@@ -52,6 +65,9 @@ UCI::UCI() {
 
 void UCI::loop() {
     std::cout << "Minke Chess Engine by Eduardo Marinho" << std::endl;
+#if USE_DISPATCH
+    std::cout << "info string using " << Dispatch::isa_name() << " kernels" << std::endl;
+#endif
 
     ucinewgame();
     std::string input, token;
@@ -70,12 +86,11 @@ void UCI::loop() {
 #endif
             if (!m_engine.stopped())
                 continue;
-            else if (m_thread.joinable())
-                m_thread.join();
+            m_engine.wait_until_idle();
             m_engine.prepare_search();
             const CounterType perft_depth = parse_go(iss);
             if (perft_depth != 0) {
-                perft(m_pos, perft_depth);
+                perft(perft_depth, m_perft_divide);
             } else {
                 go();
             }
@@ -87,9 +102,8 @@ void UCI::loop() {
             if (!m_engine.stopped()) {
                 std::cerr << "Can not set an option while searching" << std::endl;
                 continue;
-            } else if (m_thread.joinable()) {
-                m_thread.join();
             }
+            m_engine.wait_until_idle();
             set_option(iss);
         } else if (token == "eval") {
             eval();
@@ -105,12 +119,83 @@ void UCI::loop() {
         } else if (token == "bench") {
             if (!m_engine.stopped())
                 continue;
-            else if (m_thread.joinable())
-                m_thread.join();
+            m_engine.wait_until_idle();
 
             int bench_depth = EngineOptions::BENCH_DEPTH;
             iss >> std::skipws >> bench_depth;
             bench(bench_depth);
+        } else if (token == "smpbench") {
+            if (!m_engine.stopped())
+                continue;
+            m_engine.wait_until_idle();
+
+            int bench_depth = EngineOptions::BENCH_DEPTH;
+            size_t max_threads = 64;
+            iss >> std::skipws >> bench_depth >> max_threads;
+            smp_bench(bench_depth, max_threads);
+        } else if (token == "bench-nnue") {
+            if (!m_engine.stopped())
+                continue;
+            m_engine.wait_until_idle();
+
+            int rounds = 20;
+            iss >> std::skipws >> rounds;
+            nnue_bench(rounds);
+        } else if (token == "bench-movegen") {
+            if (!m_engine.stopped())
+                continue;
+            m_engine.wait_until_idle();
+
+            iss >> std::skipws >> token;
+            movegen_bench(!iss.fail() && token == "pseudo" ? Movegen::PSEUDO_LEGAL : Movegen::LEGAL);
+        } else if (token == "bench-makemove") {
+            if (!m_engine.stopped())
+                continue;
+            m_engine.wait_until_idle();
+
+            int rounds = 200;
+            iss >> std::skipws >> rounds;
+            make_move_bench(rounds);
+        } else if (token == "updatebench") {
+            if (!m_engine.stopped())
+                continue;
+            m_engine.wait_until_idle();
+
+            int rounds = 200;
+            iss >> std::skipws >> rounds;
+            update_bench(rounds);
+        } else if (token == "hashbench") {
+            if (!m_engine.stopped())
+                continue;
+            m_engine.wait_until_idle();
+
+            size_t hash_size = m_engine.tt().tt_size_mb();
+            int bench_depth = EngineOptions::BENCH_DEPTH;
+            iss >> std::skipws >> hash_size >> bench_depth;
+            hash_bench(hash_size, bench_depth);
+        } else if (token == "hashstress") {
+            if (!m_engine.stopped())
+                continue;
+            m_engine.wait_until_idle();
+
+            size_t thread_count = 4;
+            iss >> std::skipws >> thread_count;
+            hash_stress(thread_count);
+        } else if (token == "hashstats") {
+            if (!m_engine.stopped())
+                continue;
+            m_engine.wait_until_idle();
+
+            hash_stats();
+        } else if (token == "savehash" || token == "loadhash") {
+            if (!m_engine.stopped())
+                continue;
+            m_engine.wait_until_idle();
+
+            std::string path;
+            std::getline(iss >> std::ws, path);
+            const bool ok = token == "savehash" ? m_engine.tt().save(path) : m_engine.tt().load(path);
+            std::cout << "info string " << token << " " << path << (ok ? " done" : " failed") << std::endl;
         }
 #ifdef TUNE
         else if (token == "tuneinfo") {
@@ -124,8 +209,7 @@ void UCI::loop() {
         }
     } while (token != "quit");
 
-    if (m_thread.joinable())
-        m_thread.join();
+    m_engine.wait_until_idle();
 }
 
 void UCI::print_debug_info() {
@@ -218,8 +302,30 @@ void UCI::set_option(std::istringstream &iss) {
         m_engine.resize_tt(value_int);
     } else if (token == "Threads" && valid_int_value(EngineOptions::THREADS_MIN, EngineOptions::THREADS_MAX)) {
         m_engine.resize_threads(value_int);
+    } else if (token == "EvalCache" &&
+               valid_int_value(EngineOptions::EVAL_CACHE_MIN, EngineOptions::EVAL_CACHE_MAX)) {
+        m_engine.resize_eval_cache(value_int);
+    } else if (token == "HugeTLB" && valid_bool_value()) {
+        m_engine.huge_tlb(value_bool);
+    } else if (token == "NUMA" && valid_bool_value()) {
+        m_engine.numa_aware(value_bool);
     } else if (token == "UCI_Chess960" && valid_bool_value()) {
         m_pos.chess960(value_bool);
+    } else if (token == "EvalFile") {
+        std::string rest;
+        std::getline(iss, rest); // paths may contain spaces
+        value += rest;
+
+        m_engine.wait_until_idle();
+        std::string error;
+        if (load_network(value, error)) {
+            m_engine.reset_nnue();
+            m_engine.prepare_search(m_pos);
+            std::cout << "info string using network " << value << std::endl;
+        } else {
+            std::cout << "info string failed to load network " << value << ": " << error << ", keeping the previous one"
+                      << std::endl;
+        }
     }
 #ifdef TUNE
     else if (TunableParam *param_ptr = TunableParamList::get().find(token)) {
@@ -246,7 +352,7 @@ void UCI::bench(int depth) {
 
         TimeType start_time = now();
         go();
-        m_thread.join();
+        m_engine.wait_until_idle();
         nodes_searched += m_engine.nodes_searched();
         total_time += now() - start_time;
     }
@@ -274,36 +380,427 @@ void UCI::bench(int depth) {
 #endif // TRACK_ACTIVATIONS
 }
 
-int64_t UCI::perft(Position &position, CounterType depth, bool root) {
-    const bool is_leaf = (depth == 2);
-    int64_t count = 0, nodes = 0;
+void UCI::smp_bench(int depth, size_t max_threads) {
+    const size_t previous_threads = m_engine.thread_count();
 
-    Movegen::ScoredMoveList move_list;
-    Movegen::all(move_list, position);
-    for (ScoredMove score_move : move_list) {
-        const Move move = score_move.move;
-        position.make_move(move);
-
-        if (root && depth <= 1) {
-            count = 1;
-        } else if (is_leaf) {
-            Movegen::ScoredMoveList tmp;
-            Movegen::all(tmp, position);
-            count = tmp.size();
-        } else {
-            count = perft(position, depth - 1, false);
+    // Time to depth and nps of every power of two thread count, relative to a single thread
+    TimeType single_time = 0;
+    int64_t single_nps = 0;
+    m_engine.report(false);
+    for (size_t threads = 1; threads <= std::max<size_t>(max_threads, 1); threads *= 2) {
+        m_engine.resize_threads(threads);
+
+        TimeType total_time = 0;
+        int64_t nodes_searched = 0;
+        for (const std::string &fen : BENCHMARK_FEN_LIST) {
+            ucinewgame();
+            m_pos.set_fen(fen);
+            m_engine.prepare_search(m_pos);
+
+            SearchLimits sl;
+            sl.depth = depth;
+            m_engine.limit_search(sl);
+
+            TimeType start_time = now();
+            go();
+            m_engine.wait_until_idle();
+            nodes_searched += m_engine.nodes_searched();
+            total_time += now() - start_time;
+        }
+
+        const int64_t nps = nodes_searched * 1000 / (total_time + 1);
+        if (threads == 1) {
+            single_time = total_time;
+            single_nps = nps;
         }
-        nodes += count;
+        std::cout << "info threads " << threads << " depth " << depth << " time " << total_time << "ms nodes "
+                  << nodes_searched << " nps " << nps << " ttd_speedup " << std::fixed << std::setprecision(2)
+                  << static_cast<double>(single_time + 1) / (total_time + 1) << " nps_speedup "
+                  << static_cast<double>(nps) / std::max<int64_t>(single_nps, 1) << std::defaultfloat << std::endl;
+    }
+    m_engine.report(true);
+
+    m_engine.resize_threads(previous_threads);
+}
+
+void UCI::hash_bench(size_t MB, int depth) {
+    constexpr int64_t PROBE_COUNT = 1 << 24;
+    const size_t previous_size = m_engine.tt().tt_size_mb();
+
+    // Only allocated, so the first clear pays for faulting in every page and the second one is the clear alone
+    TimeType start_time = now();
+    m_engine.tt().resize(MB);
+    const TimeType resize_time = now() - start_time;
+
+    start_time = now();
+    m_engine.clear_tt();
+    const TimeType first_clear_time = now() - start_time;
+
+    start_time = now();
+    m_engine.clear_tt();
+    const TimeType clear_time = now() - start_time;
+
+    // Random hashes hit random buckets, so almost every probe misses the cache and, unless the table is backed by huge
+    // pages, the TLB as well
+    PRNG prng(0x9e3779b97f4a7c15ULL);
+    TTEntry tte;
+    int64_t hits = 0;
+    start_time = now();
+    for (int64_t i = 0; i < PROBE_COUNT; ++i) {
+        hits += m_engine.tt().probe(prng.rand<HashType>(), tte);
+    }
+    const TimeType probe_time = now() - start_time;
+
+    // Search the bench positions, the hit rate is what the different table layouts trade against each other
+    TimeType search_time = 0;
+    int64_t nodes_searched = 0, tt_probes = 0, tt_hits = 0;
+    m_engine.report(false);
+    for (const std::string &fen : BENCHMARK_FEN_LIST) {
+        ucinewgame();
+        m_pos.set_fen(fen);
+        m_engine.prepare_search(m_pos);
 
-        position.unmake_move(move);
+        SearchLimits sl;
+        sl.depth = depth;
+        m_engine.limit_search(sl);
 
-        if (root)
-            std::cout << position.move_to_uci(move) << ": " << count << std::endl;
+        start_time = now();
+        go();
+        m_engine.wait_until_idle();
+        search_time += now() - start_time;
+        nodes_searched += m_engine.nodes_searched();
+        tt_probes += m_engine.tt_probes();
+        tt_hits += m_engine.tt_hits();
     }
+    m_engine.report(true);
+
+    std::cout << "info layout " << TranspositionTable::bucket_size() << " entries of " << sizeof(TTEntry)
+              << " bytes per " << TranspositionTable::bucket_bytes() << " byte bucket\n";
+    std::cout << "info hash " << MB << " MB resize " << resize_time << "ms first clear " << first_clear_time
+              << "ms clear " << clear_time << "ms\n";
+    std::cout << "info probes " << PROBE_COUNT << " hits " << hits << " time " << probe_time << "ms "
+              << PROBE_COUNT * 1000 / (probe_time + 1) << " probes/s\n";
+    std::cout << "info depth " << depth << " nodes " << nodes_searched << " nps "
+              << nodes_searched * 1000 / (search_time + 1) << " ttprobes " << tt_probes << " tthits " << tt_hits
+              << " hitrate " << tt_hits * 1000 / std::max<int64_t>(tt_probes, 1) << " permill" << std::endl;
+
+    m_engine.resize_tt(previous_size);
+}
 
-    if (root)
-        std::cout << "\nNodes searched: " << nodes << std::endl;
-    return nodes;
+void UCI::hash_stats() {
+    const TTStats stats = m_engine.tt().stats();
+    const auto permill = [&](uint64_t count) { return count * 1000 / std::max<uint64_t>(stats.entries, 1); };
+
+    std::cout << "info string entries " << stats.entries << " used " << stats.used << " (" << permill(stats.used)
+              << " permill) hashfull " << m_engine.tt().hashfull() << "\n";
+    for (size_t age = 0; age < stats.age_histogram.size(); ++age) {
+        if (stats.age_histogram[age])
+            std::cout << "info string age -" << age << " entries " << stats.age_histogram[age] << "\n";
+    }
+    for (size_t depth = 0; depth < stats.depth_histogram.size(); ++depth) {
+        if (stats.depth_histogram[depth])
+            std::cout << "info string depth " << depth << " entries " << stats.depth_histogram[depth] << "\n";
+    }
+    std::cout << "info string bound none " << stats.bound_histogram[BOUND_EMPTY] << " exact "
+              << stats.bound_histogram[EXACT] << " lower " << stats.bound_histogram[LOWER] << " upper "
+              << stats.bound_histogram[UPPER] << "\n";
+
+    // Counters of the last search
+    for (size_t idx = 0; idx < m_engine.thread_count(); ++idx) {
+        const ThreadData &td = m_engine.td(idx);
+        std::cout << "info string thread " << idx << " probes " << td.tt_probes << " hits " << td.tt_hits
+                  << " misses " << td.tt_probes - td.tt_hits << " evalcache probes " << td.eval_cache.probes()
+                  << " hits " << td.eval_cache.hits() << "\n";
+    }
+    std::cout << std::flush;
+}
+
+void UCI::hash_stress(size_t thread_count) {
+    constexpr uint64_t PROBES_PER_THREAD = 1 << 22;
+
+    const TimeType start_time = now();
+    const TTStressReport report = TranspositionTable::stress(std::max<size_t>(thread_count, 1), PROBES_PER_THREAD);
+    const TimeType elapsed = now() - start_time;
+
+    std::cout << "info probes " << report.probes << " hits " << report.hits << " torn detected "
+              << report.torn_detected << " undetected " << report.torn_undetected << " time " << elapsed << "ms"
+              << std::endl;
+}
+
+bool UCI::movegen_bench(Movegen::GenLegality legality) {
+    uint64_t total_nodes = 0;
+    int64_t total_ns = 0;
+    int failures = 0;
+    for (size_t idx = 0; idx < PERFT_BENCHMARK_LIST.size(); ++idx) {
+        const PerftBenchmarkPosition &bench_pos = PERFT_BENCHMARK_LIST[idx];
+        Position pos;
+        pos.set_fen(bench_pos.fen);
+
+        // Single threaded and without the table, so every node is generated and played
+        const auto start = std::chrono::steady_clock::now();
+        const uint64_t nodes = ::perft(pos, bench_pos.depth, 1, 0, legality).nodes;
+        const int64_t elapsed_ns = std::max<int64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count(), 1);
+        total_nodes += nodes;
+        total_ns += elapsed_ns;
+
+        const bool correct = nodes == bench_pos.nodes;
+        failures += !correct;
+        std::cout << "info position " << idx + 1 << " depth " << bench_pos.depth << " nodes " << nodes;
+        if (!correct)
+            std::cout << " expected " << bench_pos.nodes;
+        std::cout << " time " << elapsed_ns / 1000000 << "ms mnps " << std::fixed << std::setprecision(1)
+                  << nodes * 1000.0 / elapsed_ns << std::defaultfloat << (correct ? "" : " FAILED") << std::endl;
+    }
+
+    std::cout << "\n" << total_nodes << " nodes " << total_nodes * 1000 / total_ns << " mnps";
+    if (failures)
+        std::cout << ", " << failures << " of " << PERFT_BENCHMARK_LIST.size() << " positions FAILED";
+    std::cout << std::endl;
+    return failures == 0;
+}
+
+void UCI::make_move_bench(int rounds) {
+    // Every legal move of the bench positions, made and unmade in place
+    std::vector<Position> positions(BENCHMARK_FEN_LIST.size());
+    std::vector<std::vector<Move>> moves(BENCHMARK_FEN_LIST.size());
+    size_t pairs = 0;
+    for (size_t idx = 0; idx < BENCHMARK_FEN_LIST.size(); ++idx) {
+        positions[idx].set_fen(BENCHMARK_FEN_LIST[idx]);
+        Movegen::ScoredMoveList move_list;
+        Movegen::all(move_list, positions[idx]);
+        for (ScoredMove scored_move : move_list)
+            moves[idx].push_back(scored_move.move);
+        pairs += moves[idx].size();
+    }
+
+    HashType checksum = 0;
+    const auto start = std::chrono::steady_clock::now();
+    for (int round = 0; round < rounds; ++round) {
+        for (size_t idx = 0; idx < positions.size(); ++idx) {
+            Position &pos = positions[idx];
+            for (const Move move : moves[idx]) {
+                pos.make_move(move);
+                checksum += pos.hash() ^ pos.threats_bb().raw();
+                pos.unmake_move(move);
+            }
+            pos.make_null_move();
+            checksum += pos.hash();
+            pos.unmake_null_move();
+        }
+    }
+    const auto elapsed = std::chrono::steady_clock::now() - start;
+    const int64_t elapsed_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count();
+
+    const double total_pairs = static_cast<double>(pairs + positions.size()) * std::max(rounds, 1);
+    std::cout << "info pairs " << static_cast<int64_t>(total_pairs) << " make+unmake " << std::fixed
+              << std::setprecision(1) << elapsed_ns / total_pairs << "ns" << std::defaultfloat << " state "
+              << sizeof(BoardState) << " bytes position " << sizeof(Position) << " bytes checksum " << checksum
+              << std::endl;
+}
+
+void UCI::update_bench(int rounds) {
+    // Every move of the bench positions that doesn't refresh an accumulator, applied to an up to date parent
+    struct Sample {
+        size_t parent;
+        DirtyPiece dp;
+        Square white_king_sq, black_king_sq;
+    };
+    std::vector<Accumulator> parents;
+    std::vector<Sample> samples;
+    for (const std::string &fen : BENCHMARK_FEN_LIST) {
+        Position pos;
+        pos.set_fen(fen);
+        parents.emplace_back(pos.king_sq(WHITE), pos.king_sq(BLACK), PovAccumulator(pos, WHITE),
+                             PovAccumulator(pos, BLACK));
+
+        Movegen::ScoredMoveList move_list;
+        Movegen::all(move_list, pos);
+        for (ScoredMove scored_move : move_list) {
+            const DirtyPiece dp = pos.make_move(scored_move.move);
+            if (!parents.back().needs_refresh(WHITE, pos.king_sq(WHITE)) &&
+                !parents.back().needs_refresh(BLACK, pos.king_sq(BLACK)))
+                samples.push_back({parents.size() - 1, dp, pos.king_sq(WHITE), pos.king_sq(BLACK)});
+            pos.unmake_move(scored_move.move);
+        }
+    }
+
+    // The child is rebuilt in place before every update, which only marks it stale
+    Accumulator child(samples[0].dp, samples[0].white_king_sq, samples[0].black_king_sq);
+    int64_t checksum = 0;
+    const auto time_ns = [&](auto update) {
+        const auto start = std::chrono::steady_clock::now();
+        for (int round = 0; round < rounds; ++round) {
+            for (const Sample &sample : samples) {
+                new (&child) Accumulator(sample.dp, sample.white_king_sq, sample.black_king_sq);
+                update(parents[sample.parent]);
+                checksum += child.pov(WHITE).neurons()[round % L1_SIZE] + child.pov(BLACK).neurons()[0];
+            }
+        }
+        const auto elapsed = std::chrono::steady_clock::now() - start;
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count();
+    };
+
+    const int64_t separate_ns = time_ns([&](const Accumulator &parent) {
+        child.update(WHITE, parent.pov(WHITE));
+        child.update(BLACK, parent.pov(BLACK));
+    });
+    const int64_t dual_ns = time_ns([&](const Accumulator &parent) { child.update_both(parent); });
+
+    const double updates = static_cast<double>(samples.size()) * std::max(rounds, 1);
+    std::cout << "info updates " << static_cast<int64_t>(updates) << std::fixed << std::setprecision(1)
+              << " separate " << separate_ns / updates << "ns dual " << dual_ns / updates << "ns speedup "
+              << std::setprecision(2) << static_cast<double>(separate_ns) / std::max<int64_t>(dual_ns, 1)
+              << std::defaultfloat << " checksum " << checksum << std::endl;
+}
+
+void UCI::nnue_bench(int rounds) {
+    rounds = std::max(rounds, 1);
+
+    // Corpus of the bench positions and every position one move away from them
+    struct Entry {
+        PovAccumulator stm_acc, ntm_acc;
+        int bucket;
+    };
+    std::vector<Entry> corpus;
+    std::vector<size_t> features; // of every piece of every position, from white's point of view
+    const auto for_each_position = [&](auto func) {
+        for (const std::string &fen : BENCHMARK_FEN_LIST) {
+            Position pos;
+            pos.set_fen(fen);
+            func(pos);
+
+            Movegen::ScoredMoveList move_list;
+            Movegen::all(move_list, pos);
+            for (ScoredMove scored_move : move_list) {
+                pos.make_move(scored_move.move);
+                func(pos);
+                pos.unmake_move(scored_move.move);
+            }
+        }
+    };
+    for_each_position([&](const Position &pos) {
+        corpus.push_back({PovAccumulator(pos, pos.stm()), PovAccumulator(pos, pos.nstm()),
+                          (pos.piece_count() - 2) / BUCKET_SIZE});
+        for (int sqi = a1; sqi <= h8; ++sqi) {
+            const Square sq = static_cast<Square>(sqi);
+            if (pos.piece_at(sq) != EMPTY)
+                features.push_back(feature_idx(pos.piece_at(sq), sq, pos.king_sq(WHITE), WHITE));
+        }
+    });
+    std::cout << "info string corpus " << corpus.size() << " positions, " << rounds
+              << " rounds, cycles are per call" << std::endl;
+
+    const auto report = [](const std::string &name, uint64_t calls, uint64_t cycles) {
+        std::cout << "info kernel " << name << " calls " << calls << " cycles " << std::fixed << std::setprecision(1)
+                  << static_cast<double>(cycles) / std::max<uint64_t>(calls, 1) << std::defaultfloat << std::endl;
+    };
+
+    // Accumulator updates, applied in place to a single accumulator, like search does to the hot top of its stack
+    PovAccumulator acc = corpus[0].stm_acc;
+    const auto time_update = [&](const std::string &name, size_t feature_count, auto update) {
+        const size_t calls = features.size() / feature_count * rounds;
+        const uint64_t start = cycle_count();
+        for (int round = 0; round < rounds; ++round) {
+            for (size_t idx = 0; idx + feature_count <= features.size(); idx += feature_count)
+                update(&features[idx]);
+        }
+        report(name, calls, cycle_count() - start);
+    };
+    time_update("add", 1, [&](const size_t *f) { acc.add(acc, f[0]); });
+    time_update("sub", 1, [&](const size_t *f) { acc.sub(acc, f[0]); });
+    time_update("add_sub", 2, [&](const size_t *f) { acc.add_sub(acc, f[0], f[1]); });
+    time_update("add_sub2", 3, [&](const size_t *f) { acc.add_sub2(acc, f[0], f[1], f[2]); });
+    time_update("add2_sub2", 4, [&](const size_t *f) { acc.add2_sub2(acc, f[0], f[1], f[2], f[3]); });
+
+    FinnyTable finny_table;
+    uint64_t finny_calls = 0, finny_cycles = 0;
+    int64_t checksum = acc.neurons()[0];
+    for (int round = 0; round < rounds; ++round) {
+        for_each_position([&](const Position &pos) {
+            for (const Color pov : {WHITE, BLACK}) {
+                const uint64_t start = cycle_count();
+                checksum += finny_table.update(pos, pov).neurons()[0];
+                finny_cycles += cycle_count() - start;
+                ++finny_calls;
+            }
+        });
+    }
+    report("finny_update", finny_calls, finny_cycles);
+
+    // Forward pass, every layer timed on its own
+    std::vector<Forward::Input> inputs;
+    for (const Entry &entry : corpus)
+        inputs.push_back({entry.stm_acc.neurons(), entry.ntm_acc.neurons(), entry.bucket});
+    Forward::LayerCycles cycles;
+    for (int round = 0; round < rounds; ++round) {
+#if USE_DISPATCH
+        Dispatch::kernels().bench(inputs, cycles);
+#else
+        Forward::bench(inputs, cycles);
+#endif
+    }
+    checksum += cycles.checksum;
+
+    const auto total = [](const auto &per_bucket) {
+        return std::accumulate(per_bucket.begin(), per_bucket.end(), 0ull);
+    };
+    const uint64_t calls = total(cycles.calls);
+    report("activate_ft", calls, total(cycles.activate_ft));
+    report("propagate_l1", calls, total(cycles.propagate_l1));
+    report("propagate_l2", calls, total(cycles.propagate_l2));
+    report("propagate_l3", calls, total(cycles.propagate_l3));
+
+    for (int bucket = 0; bucket < OUTPUT_BUCKET_COUNT; ++bucket) {
+        const uint64_t bucket_calls = std::max<uint64_t>(cycles.calls[bucket], 1);
+        if (cycles.calls[bucket] == 0)
+            continue;
+        std::cout << "info bucket " << bucket << " calls " << cycles.calls[bucket] << std::fixed
+                  << std::setprecision(1) << " activate_ft "
+                  << static_cast<double>(cycles.activate_ft[bucket]) / bucket_calls << " propagate_l1 "
+                  << static_cast<double>(cycles.propagate_l1[bucket]) / bucket_calls << " propagate_l2 "
+                  << static_cast<double>(cycles.propagate_l2[bucket]) / bucket_calls << " propagate_l3 "
+                  << static_cast<double>(cycles.propagate_l3[bucket]) / bucket_calls << std::defaultfloat
+                  << std::endl;
+    }
+
+    // Non-zero 4-byte chunks of the L1 input, i.e. the work of the sparse L1 matmul
+    const auto percentile = [&](uint64_t permill) {
+        uint64_t seen = 0;
+        for (size_t nnz = 0; nnz < cycles.nnz_histogram.size(); ++nnz) {
+            seen += cycles.nnz_histogram[nnz];
+            if (seen * 1000 >= calls * permill)
+                return nnz;
+        }
+        return cycles.nnz_histogram.size() - 1;
+    };
+    uint64_t nnz_sum = 0;
+    for (size_t nnz = 0; nnz < cycles.nnz_histogram.size(); ++nnz)
+        nnz_sum += nnz * cycles.nnz_histogram[nnz];
+    std::cout << "info nnz chunks " << cycles.nnz_histogram.size() - 1 << " mean " << std::fixed
+              << std::setprecision(1) << static_cast<double>(nnz_sum) / std::max<uint64_t>(calls, 1)
+              << std::defaultfloat << " p10 " << percentile(100) << " p50 " << percentile(500) << " p90 "
+              << percentile(900) << " max " << percentile(1000) << " checksum " << checksum << std::endl;
+}
+
+void UCI::perft(CounterType depth, bool divide) {
+    if (depth < 1) {
+        std::cout << "info string perft depth must be at least 1" << std::endl;
+        return;
+    }
+
+    const TimeType start_time = now();
+    const PerftResult result = ::perft(m_pos, depth, m_engine.thread_count(), m_engine.tt().tt_size_mb());
+    // Add 1 to the elapsed time to avoid division by 0
+    const TimeType elapsed = now() - start_time;
+
+    if (divide) {
+        for (const auto &[move, nodes] : result.divide)
+            std::cout << m_pos.move_to_uci(move) << ": " << nodes << "\n";
+        std::cout << "\n";
+    }
+    std::cout << "Nodes searched: " << result.nodes << std::endl;
+    std::cout << "Time: " << elapsed << "ms, " << result.nodes * 1000 / (elapsed + 1) << " nps" << std::endl;
 }
 
 void UCI::eval() { std::cout << "The position evaluation is " << m_engine.static_eval() << std::endl; }
@@ -321,6 +818,7 @@ CounterType UCI::parse_go(std::istringstream &iss, bool bench) {
         CounterType option;
         iss >> option;
         if (token == "perft" && !iss.fail()) { // Don't "perft" if depth hasn't been passed
+            m_perft_divide = (iss >> token) && token == "divide";
             return option;
         } else if (token == "depth") {
             limits.depth = option;
@@ -345,14 +843,19 @@ CounterType UCI::parse_go(std::istringstream &iss, bool bench) {
     return 0;
 }
 
-void UCI::go() { m_thread = std::thread(&Engine::search, std::ref(m_engine)); }
+void UCI::go() { m_engine.start_search(); }
 
 void EngineOptions::print() {
     std::cout << "option name Hash type spin default " << HASH_DEFAULT << " min " << HASH_MIN << " max " << HASH_MAX
               << "\n";
     std::cout << "option name Threads type spin default " << THREADS_DEFAULT << " min " << THREADS_MIN << " max "
               << THREADS_MAX << "\n";
+    std::cout << "option name EvalCache type spin default " << EVAL_CACHE_DEFAULT << " min " << EVAL_CACHE_MIN
+              << " max " << EVAL_CACHE_MAX << "\n";
+    std::cout << "option name HugeTLB type check default false\n";
+    std::cout << "option name NUMA type check default false\n";
     std::cout << "option name UCI_Chess960 type check default false\n";
+    std::cout << "option name EvalFile type string default <embedded>\n";
 
 #ifdef TUNE
     for (const TunableParam &tunable_param : TunableParamList::get()) {
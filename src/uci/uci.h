@@ -20,8 +20,8 @@
 
 #include <cstdint>
 #include <sstream>
-#include <thread>
 
+#include "core/movegen.h"
 #include "core/position.h"
 #include "core/types.h"
 #include "search/search.h"
@@ -34,6 +34,9 @@ static constexpr CounterType HASH_MAX = 2097152;
 static constexpr CounterType THREADS_DEFAULT = 1;
 static constexpr CounterType THREADS_MIN = 1;
 static constexpr CounterType THREADS_MAX = 2048;
+static constexpr CounterType EVAL_CACHE_DEFAULT = 1; // MiB per thread
+static constexpr CounterType EVAL_CACHE_MIN = 0;
+static constexpr CounterType EVAL_CACHE_MAX = 1024;
 void print();
 } // namespace EngineOptions
 
@@ -43,6 +46,16 @@ class UCI {
     ~UCI() = default;
     void loop();
     void bench(int depth);
+    void smp_bench(int depth, size_t max_threads);
+    void hash_bench(size_t MB, int depth);
+    void hash_stats();
+    void hash_stress(size_t thread_count);
+    /// Perft of every position of PERFT_BENCHMARK_LIST, returns whether all of them match their known counts
+    bool movegen_bench(Movegen::GenLegality legality);
+    /// Times make_move plus unmake_move of every legal move of the bench positions, and a null move for each of them
+    void make_move_bench(int rounds);
+    void update_bench(int rounds);
+    void nnue_bench(int rounds);
 
   private:
     void position(std::istringstream &);
@@ -53,13 +66,15 @@ class UCI {
 
     /// Returns perft depth or 0 if should not perft
     CounterType parse_go(std::istringstream &, bool bench = false);
-    int64_t perft(Position &position, CounterType depth, bool root = true);
+    /// Perft of the current position on the Threads threads, with a table of Hash MB. 'divide' also reports the count
+    /// of every root move
+    void perft(CounterType depth, bool divide);
     void go();
 
     void print_debug_info();
     void eval();
 
-    std::thread m_thread;
     Position m_pos;
     Engine m_engine;
+    bool m_perft_divide{false};
 };
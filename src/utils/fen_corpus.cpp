@@ -0,0 +1,59 @@
+/*
+ *  Minke is a UCI chess engine
+ *  Copyright (C) 2026 Eduardo Marinho <eduardomarinho@pm.me>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "utils/fen_corpus.h"
+
+#include <algorithm>
+#include <cctype>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+std::vector<std::string> read_fen_corpus(const std::string &path) {
+    std::vector<std::string> fens;
+    std::ifstream in_file(path);
+    std::string line;
+    while (std::getline(in_file, line)) {
+        line = line.substr(0, line.find_first_of("|;"));
+
+        // EPDs lack the move counters, which set_fen requires, and may have opcodes in their place
+        std::istringstream iss(line);
+        std::string field, fen;
+        int field_count = 0;
+        for (; field_count < 4 && iss >> field; ++field_count)
+            fen += (field_count == 0 ? "" : " ") + field;
+        if (field_count < 4)
+            continue;
+
+        // A FEN that lacks only the fullmove number keeps its halfmove clock
+        const auto is_number = [](const std::string &str) {
+            return !str.empty() && std::all_of(str.begin(), str.end(), ::isdigit);
+        };
+        std::string half_move, full_move;
+        iss >> half_move >> full_move;
+        if (!is_number(half_move)) {
+            half_move = "0";
+            full_move = "1";
+        } else if (!is_number(full_move)) {
+            full_move = "1";
+        }
+        fens.push_back(fen + " " + half_move + " " + full_move);
+    }
+    return fens;
+}
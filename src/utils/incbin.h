@@ -11,7 +11,9 @@
 #ifndef INCBIN_HDR
 #define INCBIN_HDR
 #include <limits.h>
-#if defined(__AVX512BW__) || defined(__AVX512CD__) || defined(__AVX512DQ__) || \
+#if defined(INCBIN_ALIGNMENT_INDEX)
+/* Set by the includer */
+#elif defined(__AVX512BW__) || defined(__AVX512CD__) || defined(__AVX512DQ__) || \
     defined(__AVX512ER__) || defined(__AVX512PF__) || defined(__AVX512VL__) || \
     defined(__AVX512F__)
 #define INCBIN_ALIGNMENT_INDEX 6
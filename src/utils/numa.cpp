@@ -0,0 +1,151 @@
+/*
+ *  Minke is a UCI chess engine
+ *  Copyright (C) 2026 Eduardo Marinho <eduardomarinho@pm.me>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "utils/numa.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#if defined(__linux__)
+#include <linux/mempolicy.h>
+#include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace Numa {
+
+#if defined(__linux__)
+
+/// Parses sysfs lists such as "0-15,32-47"
+static std::vector<int> parse_list(const std::string &list) {
+    std::vector<int> values;
+    std::istringstream iss(list);
+    std::string range;
+    while (std::getline(iss, range, ',')) {
+        if (range.empty() || range == "\n")
+            continue;
+
+        const size_t dash = range.find('-');
+        const int first = std::stoi(range.substr(0, dash));
+        const int last = dash == std::string::npos ? first : std::stoi(range.substr(dash + 1));
+        for (int value = first; value <= last; ++value)
+            values.push_back(value);
+    }
+    return values;
+}
+
+static std::string read_sysfs(const std::string &path) {
+    std::ifstream file(path);
+    std::string content;
+    std::getline(file, content);
+    return content;
+}
+
+struct Node {
+    int id;
+    std::vector<int> cpus;
+};
+
+/// Online nodes that have CPUs. Empty if the topology could not be read
+static const std::vector<Node> &topology() {
+    static const std::vector<Node> nodes = []() {
+        std::vector<Node> result;
+        try {
+            for (int id : parse_list(read_sysfs("/sys/devices/system/node/online"))) {
+                std::vector<int> cpus =
+                    parse_list(read_sysfs("/sys/devices/system/node/node" + std::to_string(id) + "/cpulist"));
+                if (!cpus.empty()) // memory-only nodes have no CPUs to bind to
+                    result.push_back({id, std::move(cpus)});
+            }
+        } catch (...) {
+            result.clear();
+        }
+        return result;
+    }();
+    return nodes;
+}
+
+/// Affinity the process was started with (e.g. through taskset), which binding never escapes from
+static const cpu_set_t initial_mask = []() {
+    cpu_set_t mask;
+    CPU_ZERO(&mask);
+    sched_getaffinity(0, sizeof(mask), &mask);
+    return mask;
+}();
+
+size_t node_count() { return std::max<size_t>(topology().size(), 1); }
+
+void bind_thread(size_t thread_idx) {
+    if (node_count() <= 1)
+        return;
+
+    const Node &node = topology()[thread_idx % node_count()];
+    cpu_set_t mask;
+    CPU_ZERO(&mask);
+    for (int cpu : node.cpus)
+        if (CPU_ISSET(cpu, &initial_mask))
+            CPU_SET(cpu, &mask);
+
+    if (CPU_COUNT(&mask) > 0)
+        sched_setaffinity(0, sizeof(mask), &mask);
+}
+
+void unbind_thread() {
+    if (node_count() <= 1)
+        return;
+
+    sched_setaffinity(0, sizeof(initial_mask), &initial_mask);
+}
+
+void interleave(void *ptr, size_t bytes) {
+    if (node_count() <= 1 || ptr == nullptr || bytes == 0)
+        return;
+
+    // mbind requires a page aligned range
+    const uintptr_t page_size = sysconf(_SC_PAGESIZE);
+    const uintptr_t begin = reinterpret_cast<uintptr_t>(ptr) & ~(page_size - 1);
+    const uintptr_t end = (reinterpret_cast<uintptr_t>(ptr) + bytes + page_size - 1) & ~(page_size - 1);
+
+    unsigned long node_mask = 0;
+    for (const Node &node : topology())
+        if (node.id < static_cast<int>(8 * sizeof(node_mask)))
+            node_mask |= 1ul << node.id;
+
+    syscall(SYS_mbind, begin, end - begin, MPOL_INTERLEAVE, &node_mask, 8 * sizeof(node_mask), 0);
+}
+
+#else
+
+size_t node_count() { return 1; }
+
+void bind_thread(size_t) {}
+
+void unbind_thread() {}
+
+void interleave(void *, size_t) {}
+
+#endif
+
+} // namespace Numa
@@ -0,0 +1,40 @@
+/*
+ *  Minke is a UCI chess engine
+ *  Copyright (C) 2026 Eduardo Marinho <eduardomarinho@pm.me>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <cstddef>
+
+/// Minimal NUMA support, implemented on Linux through sysfs and raw syscalls so that no libnuma is needed. On other
+/// platforms, or on machines with a single node, every function is a no-op.
+namespace Numa {
+
+/// Number of online NUMA nodes, 1 if the topology could not be read
+size_t node_count();
+
+/// Binds the calling thread to the CPUs of the node assigned to search thread 'thread_idx'. Threads are distributed
+/// among the nodes in round-robin
+void bind_thread(size_t thread_idx);
+
+/// Allows the calling thread to run on any CPU again
+void unbind_thread();
+
+/// Spreads the pages of [ptr, ptr + bytes) across all nodes. Only affects pages that were not touched yet
+void interleave(void *ptr, size_t bytes);
+
+} // namespace Numa
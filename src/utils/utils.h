@@ -19,7 +19,13 @@
 #pragma once
 
 #include <cassert>
+#include <chrono>
 #include <cstddef>
+#include <cstdint>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
 
 #include "core/types.h"
 
@@ -94,3 +100,43 @@ inline void aligned_free(void *ptr) {
     std::free(ptr);
 #endif
 }
+
+constexpr size_t LARGE_PAGE_SIZE = 2 * 1024 * 1024;
+
+/// Allocates memory for big tables, aligned to 2MB so that transparent huge pages can back it. If 'hugetlb' is set,
+/// explicit hugetlbfs pages are tried first, which only succeeds when the administrator reserved them through
+/// vm.nr_hugepages. 'mapped' tells whether the memory must be released with large_page_free(..., true)
+inline void *large_page_alloc(size_t required_bytes, [[maybe_unused]] bool hugetlb, bool &mapped) {
+    mapped = false;
+#if defined(__linux__)
+    if (hugetlb) {
+        const size_t bytes = (required_bytes + LARGE_PAGE_SIZE - 1) / LARGE_PAGE_SIZE * LARGE_PAGE_SIZE;
+        void *ptr = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (ptr != MAP_FAILED) {
+            mapped = true;
+            return ptr;
+        }
+    }
+#endif
+    return aligned_malloc(LARGE_PAGE_SIZE, required_bytes);
+}
+
+inline void large_page_free(void *ptr, [[maybe_unused]] size_t required_bytes, [[maybe_unused]] bool mapped) {
+#if defined(__linux__)
+    if (mapped) {
+        munmap(ptr, (required_bytes + LARGE_PAGE_SIZE - 1) / LARGE_PAGE_SIZE * LARGE_PAGE_SIZE);
+        return;
+    }
+#endif
+    aligned_free(ptr);
+}
+
+/// Time stamp counter cycles on x86, nanoseconds elsewhere. Only meant for microbenchmarks
+inline uint64_t cycle_count() {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+#endif
+}
@@ -1,3 +1,6 @@
+#include <algorithm>
+#include <array>
+#include <cmath>
 #include <cstddef>
 #include <cstdint>
 #include <cstdio>
@@ -12,6 +15,7 @@
 #include <span>
 #include <string>
 #include <variant>
+#include <vector>
 
 #include "eval/nnue/arch.h"
 #include "eval/nnue/simd.h"
@@ -21,10 +25,11 @@ using Err = std::string;
 template <typename T>
 using Result = std::variant<T, Err>;
 
-using RawNetworkData = std::array<uint8_t, sizeof(Network)>;
+using RawNetworkData = std::array<uint8_t, sizeof(FullNetwork)>;
 using RawNetwork = std::unique_ptr<RawNetworkData>;
 
-constexpr std::array<size_t, PAIR_COUNT> activation_counts = {
+// Activation counts of minke39, used when no counts collected for the net being processed are given
+constexpr std::array<size_t, PAIR_COUNT> default_activation_counts = {
     1858391, 1169548, 1543448, 1474654, 1045212,  331929,  3333282, 194757,  535889,  1355707, 1682462, 226188,
     2963083, 6021034, 982159,  514056,  291702,   2146109, 765850,  360204,  720853,  490325,  1081795, 1114100,
     538277,  902327,  771163,  1003677, 931427,   187238,  566099,  376726,  774391,  220990,  3740056, 902717,
@@ -80,12 +85,12 @@ constexpr std::array<size_t, PAIR_COUNT> activation_counts = {
     910023,  1680849, 1221794, 644875,  798620,   454268,  3395906, 1432234, 2105300, 826281,  125071,  5464395,
     957256,  803534,  1702850, 1159196};
 
-std::array<uint16_t, L1_SIZE> build_permutation() {
+std::array<uint16_t, L1_SIZE> build_permutation(const std::array<size_t, PAIR_COUNT>& activation_counts) {
     std::array<uint16_t, PAIR_COUNT> order;
     std::iota(order.begin(), order.end(), 0);
 
     std::stable_sort(order.begin(), order.end(),
-                     [](uint16_t a, uint16_t b) { return activation_counts[a] > activation_counts[b]; });
+                     [&](uint16_t a, uint16_t b) { return activation_counts[a] > activation_counts[b]; });
 
     // perm_full[new_idx] = old_idx
     std::array<uint16_t, L1_SIZE> perm_full;
@@ -96,18 +101,28 @@ std::array<uint16_t, L1_SIZE> build_permutation() {
     return perm_full;
 }
 
-std::unique_ptr<Network> transpose(const RawNetwork& raw_net) {
-    std::unique_ptr<Network> net = std::make_unique_for_overwrite<Network>();
+// FNV-1a of the neuron order, recorded in the trailer so nets sorted by different counts can be told apart
+uint64_t hash_permutation(const std::array<uint16_t, L1_SIZE>& perm_full) {
+    uint64_t hash = 0xcbf29ce484222325ull;
+    for (const uint16_t old_idx : perm_full) {
+        hash ^= old_idx;
+        hash *= 0x100000001b3ull;
+    }
+    return hash;
+}
+
+std::unique_ptr<FullNetwork> transpose(const RawNetwork& raw_net) {
+    std::unique_ptr<FullNetwork> net = std::make_unique_for_overwrite<FullNetwork>();
     const uint8_t* base_ptr = reinterpret_cast<const uint8_t*>(raw_net->data());
 
     // Copy FT weights
-    std::memcpy(net->ft_weights, base_ptr + offsetof(Network, ft_weights), sizeof(net->ft_weights));
+    std::memcpy(net->ft_weights, base_ptr + offsetof(FullNetwork, ft_weights), sizeof(net->ft_weights));
 
     // Copy FT biases
-    std::memcpy(net->ft_biases, base_ptr + offsetof(Network, ft_biases), sizeof(net->ft_biases));
+    std::memcpy(net->ft_biases, base_ptr + offsetof(FullNetwork, ft_biases), sizeof(net->ft_biases));
 
     // Transform raw l1 weights, bullet output (transposed: (output_buckets * l2_size) x l1_size) into VNNI layout
-    std::span<const int8_t> raw_l1w{reinterpret_cast<const int8_t*>(base_ptr + offsetof(Network, l1_weights)),
+    std::span<const int8_t> raw_l1w{reinterpret_cast<const int8_t*>(base_ptr + offsetof(FullNetwork, l1_weights)),
                                     sizeof(net->l1_weights) / sizeof(int8_t)};
     for (int l1_idx = 0; l1_idx < L1_SIZE; ++l1_idx) {
         for (int out_bucket_idx = 0; out_bucket_idx < OUTPUT_BUCKET_COUNT; ++out_bucket_idx) {
@@ -119,7 +134,7 @@ std::unique_ptr<Network> transpose(const RawNetwork& raw_net) {
     }
 
     // Copy L1 biases
-    std::span<const int32_t> raw_l1b{reinterpret_cast<const int32_t*>(base_ptr + offsetof(Network, l1_biases)),
+    std::span<const int32_t> raw_l1b{reinterpret_cast<const int32_t*>(base_ptr + offsetof(FullNetwork, l1_biases)),
                                      sizeof(net->l1_biases) / sizeof(int32_t)};
     for (int out_bucket_idx = 0; out_bucket_idx < OUTPUT_BUCKET_COUNT; ++out_bucket_idx) {
         for (int l2_idx = 0; l2_idx < L2_SIZE; ++l2_idx) {
@@ -129,7 +144,7 @@ std::unique_ptr<Network> transpose(const RawNetwork& raw_net) {
     }
 
     // Transform raw l2 weights, bullet output (transposed: (output_buckets * l3_size) x l2_size)
-    std::span<const int32_t> raw_l2w{reinterpret_cast<const int32_t*>(base_ptr + offsetof(Network, l2_weights)),
+    std::span<const int32_t> raw_l2w{reinterpret_cast<const int32_t*>(base_ptr + offsetof(FullNetwork, l2_weights)),
                                      sizeof(net->l2_weights) / sizeof(int32_t)};
     for (int l2_idx = 0; l2_idx < ACTUAL_L2_SIZE; ++l2_idx) {
         for (int out_bucket_idx = 0; out_bucket_idx < OUTPUT_BUCKET_COUNT; ++out_bucket_idx) {
@@ -141,10 +156,10 @@ std::unique_ptr<Network> transpose(const RawNetwork& raw_net) {
     }
 
     // L2 biases
-    std::memcpy(net->l2_biases, base_ptr + offsetof(Network, l2_biases), sizeof(net->l2_biases));
+    std::memcpy(net->l2_biases, base_ptr + offsetof(FullNetwork, l2_biases), sizeof(net->l2_biases));
 
     // Transform raw l3 weights, bullet output (transposed: output_buckets x l3_size)
-    std::span<const int32_t> raw_l3w{reinterpret_cast<const int32_t*>(base_ptr + offsetof(Network, l3_weights)),
+    std::span<const int32_t> raw_l3w{reinterpret_cast<const int32_t*>(base_ptr + offsetof(FullNetwork, l3_weights)),
                                      sizeof(net->l3_weights) / sizeof(int32_t)};
     for (int l3_idx = 0; l3_idx < L3_SIZE; ++l3_idx) {
         for (int out_bucket_idx = 0; out_bucket_idx < OUTPUT_BUCKET_COUNT; ++out_bucket_idx) {
@@ -154,7 +169,7 @@ std::unique_ptr<Network> transpose(const RawNetwork& raw_net) {
     }
 
     // L3 biases
-    std::memcpy(net->l3_biases, base_ptr + offsetof(Network, l3_biases), sizeof(net->l3_biases));
+    std::memcpy(net->l3_biases, base_ptr + offsetof(FullNetwork, l3_biases), sizeof(net->l3_biases));
 
     return net;
 }
@@ -162,8 +177,9 @@ std::unique_ptr<Network> transpose(const RawNetwork& raw_net) {
 // Reorders the L1_SIZE ("neuron pair") dimension of a raw network so that
 // pair-indices with similar (low) activation frequency land in the same 4-wide chunk. This
 // increases the fraction of all-zero uint8 chunks that propagate_l1's SparseIterator can skip.
-void repermute_for_sparsity(std::unique_ptr<Network>& net) {
-    const auto perm_full = build_permutation();
+void repermute_for_sparsity(std::unique_ptr<FullNetwork>& net,
+                            const std::array<size_t, PAIR_COUNT>& activation_counts) {
+    const auto perm_full = build_permutation(activation_counts);
 
     std::array<int16_t, L1_SIZE> tmp{};
 
@@ -198,7 +214,7 @@ void repermute_for_sparsity(std::unique_ptr<Network>& net) {
     }
 }
 
-void permute_network_ft_params(std::unique_ptr<Network>& net) {
+void permute_network_ft_params(std::unique_ptr<FullNetwork>& net) {
     using namespace simd;
 
     // permutation for packus lane-crossing, necessary to avoid doing so in the network inference hot-path
@@ -232,6 +248,85 @@ void permute_network_ft_params(std::unique_ptr<Network>& net) {
     }
 }
 
+#if USE_FT_INT8
+// Stores the weights of every feature as int8 times the smallest scale that fits its largest weight, which is
+// lossless for nets whose feature transformer weights already fit in int8
+std::unique_ptr<Network> compress_ft_weights(const std::unique_ptr<FullNetwork>& full_net) {
+    std::unique_ptr<Network> net = std::make_unique_for_overwrite<Network>();
+
+    int max_error = 0;
+    int64_t total_error = 0;
+    size_t scaled_features = 0;
+    for (size_t feature = 0; feature < NUM_KING_BUCKETS * INPUT_LAYER_SIZE; ++feature) {
+        const int16_t* weights = full_net->ft_weights + feature * L1_SIZE;
+        int max_weight = 0;
+        for (size_t column = 0; column < L1_SIZE; ++column)
+            max_weight = std::max(max_weight, std::abs(static_cast<int>(weights[column])));
+
+        const int scale = std::max(1, (max_weight + 126) / 127);
+        net->ft_scales[feature] = static_cast<int16_t>(scale);
+        scaled_features += scale > 1;
+        for (size_t column = 0; column < L1_SIZE; ++column) {
+            const long rounded = std::lround(static_cast<double>(weights[column]) / scale);
+            const int quantized = static_cast<int>(std::clamp(rounded, -127l, 127l));
+            net->ft_weights[feature * L1_SIZE + column] = static_cast<int8_t>(quantized);
+
+            const int error = std::abs(quantized * scale - weights[column]);
+            max_error = std::max(max_error, error);
+            total_error += error;
+        }
+    }
+    std::cout << "int8 feature transformer: " << scaled_features << " scaled features, weight error max " << max_error
+              << " mean " << static_cast<double>(total_error) / std::size(net->ft_weights) << "\n";
+
+    // Everything else is kept as is
+    std::memcpy(net->ft_biases, full_net->ft_biases, sizeof(net->ft_biases));
+    std::memcpy(net->l1_weights, full_net->l1_weights, sizeof(net->l1_weights));
+    std::memcpy(net->l1_biases, full_net->l1_biases, sizeof(net->l1_biases));
+    std::memcpy(net->l2_weights, full_net->l2_weights, sizeof(net->l2_weights));
+    std::memcpy(net->l2_biases, full_net->l2_biases, sizeof(net->l2_biases));
+    std::memcpy(net->l3_weights, full_net->l3_weights, sizeof(net->l3_weights));
+    std::memcpy(net->l3_biases, full_net->l3_biases, sizeof(net->l3_biases));
+
+    return net;
+}
+#endif // USE_FT_INT8
+
+// Records the layout the net was processed into, which the engine checks before using it
+NetworkTrailer make_trailer(const std::optional<std::array<size_t, PAIR_COUNT>>& activation_counts) {
+    NetworkTrailer trailer{};
+    std::memcpy(trailer.magic, NETWORK_MAGIC, sizeof(trailer.magic));
+    trailer.ft_weight_size = sizeof(Network::ft_weights[0]);
+#if USE_SIMD
+    trailer.packus_lane_count = simd::PACKUS_LANE_COUNT;
+    for (size_t lane = 0; lane < simd::PACKUS_LANE_COUNT; ++lane)
+        trailer.packus_lane_order[lane] = simd::PACKUS_LANE_ORDER[lane];
+#else
+    trailer.packus_lane_count = 1;
+#endif
+    if (activation_counts.has_value())
+        trailer.permutation_hash = hash_permutation(build_permutation(activation_counts.value()));
+    return trailer;
+}
+
+// Reads the comma separated counts written by "minke activations", or by bench in TRACK_ACTIVATIONS builds
+Result<std::array<size_t, PAIR_COUNT>> read_in_activation_counts(const std::string& in_path) {
+    std::ifstream in_file(in_path);
+    if (!in_file) {
+        return "Failed to open activation counts file: " + in_path;
+    }
+
+    std::array<size_t, PAIR_COUNT> activation_counts;
+    for (size_t idx = 0; idx < PAIR_COUNT; ++idx) {
+        char separator;
+        if ((idx > 0 && !(in_file >> separator && separator == ',')) || !(in_file >> activation_counts[idx])) {
+            return "Activation counts file should hold " + std::to_string(PAIR_COUNT) + " comma separated counts.";
+        }
+    }
+
+    return activation_counts;
+}
+
 Result<RawNetwork> read_in_raw_network(const std::string& in_path) {
     std::ifstream in_file(in_path, std::ios::binary);
     if (!in_file) {
@@ -239,7 +334,7 @@ Result<RawNetwork> read_in_raw_network(const std::string& in_path) {
     }
 
     size_t size = std::filesystem::file_size(in_path);
-    if (size != sizeof(Network)) {
+    if (size != sizeof(FullNetwork)) {
         return "Input file has an unexpected size.";
     }
 
@@ -266,11 +361,25 @@ std::optional<std::string> write_out(const std::string& out_path, std::span<cons
 }
 
 int main(int argc, char* argv[]) {
-    if (argc != 3) {
-        std::cerr << "Usage: " << argv[0] << " <preprocessed_net.nnue> <processed_net.nnue>\n";
+    if (argc != 3 && argc != 4) {
+        std::cerr << "Usage: " << argv[0]
+                  << " <preprocessed_net.nnue> <processed_net.nnue> [activation_counts.txt|none]\n"
+                  << "Neurons are ordered by the given activation counts, minke39's by default. none keeps them\n";
         return EXIT_FAILURE;
     }
 
+    std::optional<std::array<size_t, PAIR_COUNT>> activation_counts = default_activation_counts;
+    if (argc == 4 && std::string(argv[3]) == "none") {
+        activation_counts = std::nullopt;
+    } else if (argc == 4) {
+        auto counts_or_err = read_in_activation_counts(argv[3]);
+        if (std::holds_alternative<Err>(counts_or_err)) {
+            std::cerr << "Err: " << std::get<Err>(counts_or_err) << std::endl;
+            return EXIT_FAILURE;
+        }
+        activation_counts = std::get<std::array<size_t, PAIR_COUNT>>(counts_or_err);
+    }
+
     const std::string in_path = argv[1];
     auto raw_net_or_err = read_in_raw_network(in_path);
 
@@ -282,11 +391,22 @@ int main(int argc, char* argv[]) {
 
     const auto& raw_net = std::get<RawNetwork>(raw_net_or_err);
     auto net = transpose(raw_net);
-    repermute_for_sparsity(net);
+    if (activation_counts.has_value())
+        repermute_for_sparsity(net, activation_counts.value());
     permute_network_ft_params(net);
 
     const std::string out_path = argv[2];
-    std::span out_bytes{reinterpret_cast<const uint8_t*>(net.get()), sizeof(Network)};
+#if USE_FT_INT8
+    const auto out_net = compress_ft_weights(net);
+#else
+    const auto& out_net = net;
+#endif
+
+    // The trailer goes after the net, so the net itself stays aligned wherever the file is mapped
+    const NetworkTrailer trailer = make_trailer(activation_counts);
+    std::vector<uint8_t> out_bytes(sizeof(Network) + sizeof(NetworkTrailer));
+    std::memcpy(out_bytes.data(), out_net.get(), sizeof(Network));
+    std::memcpy(out_bytes.data() + sizeof(Network), &trailer, sizeof(NetworkTrailer));
     auto err_msg = write_out(out_path, out_bytes);
 
     // File write failed